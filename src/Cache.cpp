@@ -0,0 +1,147 @@
+#include "Cache.hpp"
+#include "Hash.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace filesystem;
+
+// Bumped whenever a decoder or the layout of the cache changes, so that entries written by older builds are never reused
+const uint64_t CacheVersion = 2;
+
+// Outputs are independent copies of their entries, sharing blocks only where the filesystem can clone them
+static void Clone(const path& from, const path& to, error_code& ec)
+{
+#ifdef __linux__
+	int in = open(from.c_str(), O_RDONLY | O_CLOEXEC);
+
+	if (in >= 0)
+	{
+		int out = open(to.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		bool cloned = (out >= 0) && (ioctl(out, FICLONE, in) == 0);
+
+		if (out >= 0)
+		{
+			close(out);
+		}
+
+		close(in);
+
+		if (cloned)
+		{
+			return;
+		}
+	}
+#endif
+
+	copy_file(from, to, copy_options::overwrite_existing, ec);
+}
+
+Cache::Cache(const char* dirName) : Dir(dirName)
+{
+	error_code ec;
+
+	create_directories(Dir, ec);
+}
+
+// Entries are named by the version, the hash and the full length of their source, all of which have to match for one to be reused
+path Cache::Entry(const uint8_t* data, size_t length, const string& extension)
+{
+	char name[34];
+	snprintf(name, sizeof(name), "%016llx-%llx", static_cast<unsigned long long>(Hash64(data, length)), static_cast<unsigned long long>(length));
+
+	return Dir / ("v" + to_string(CacheVersion)) / string(name, 2) / (string(name) + "." + extension);
+}
+
+bool Cache::Fetch(const path& entry, const path& fileName)
+{
+	error_code ec;
+
+	remove(fileName, ec);
+	Clone(entry, fileName, ec);
+
+	if (!ec)
+	{
+		permissions(fileName, perms::owner_write, perm_options::add, ec);
+	}
+
+	return !ec;
+}
+
+void Cache::Store(const path& entry, const path& fileName)
+{
+	error_code ec;
+
+	create_directories(entry.parent_path(), ec);
+
+	path temporary = Temporary(entry);
+
+	Clone(fileName, temporary, ec);
+
+	// Entries are read-only, so that nothing writing through an output can reach the cache
+	if (!ec)
+	{
+		permissions(temporary, perms::owner_read | perms::group_read | perms::others_read, ec);
+	}
+
+	if (!ec)
+	{
+		rename(temporary, entry, ec);
+	}
+
+	if (ec)
+	{
+		remove(temporary, ec);
+	}
+}
+
+void Cache::Store(const path& entry, const vector<uint8_t>& data)
+{
+	error_code ec;
+
+	create_directories(entry.parent_path(), ec);
+
+	path temporary = Temporary(entry);
+
+	ofstream ofs(temporary, ofstream::binary);
+	ofs.write(reinterpret_cast<const char*>(data.data()), static_cast<streamsize>(data.size()));
+	ofs.close();
+
+	if (ofs)
+	{
+		permissions(temporary, perms::owner_read | perms::group_read | perms::others_read, ec);
+	}
+
+	if (ofs && !ec)
+	{
+		rename(temporary, entry, ec);
+	}
+
+	if (!ofs || ec)
+	{
+		remove(temporary, ec);
+	}
+}
+
+// Entries only ever appear whole, so concurrent runs sharing a cache never see one half written
+path Cache::Temporary(const path& entry)
+{
+	static thread_local mt19937_64 random(random_device{}());
+
+	return path(entry).concat("." + to_string(random()) + ".tmp");
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+struct Cache
+{
+	std::filesystem::path Dir;
+
+	Cache(const char* dirName);
+	std::filesystem::path Entry(const uint8_t* data, size_t length, const std::string& extension);
+	bool Fetch(const std::filesystem::path& entry, const std::filesystem::path& fileName);
+	void Store(const std::filesystem::path& entry, const std::filesystem::path& fileName);
+	void Store(const std::filesystem::path& entry, const std::vector<uint8_t>& data);
+	std::filesystem::path Temporary(const std::filesystem::path& entry);
+};
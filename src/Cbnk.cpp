@@ -1,19 +1,26 @@
 #include "Cbnk.hpp"
 #include "Common.hpp"
 #include "Cwar.hpp"
+#include "Hash.hpp"
+#include "Index.hpp"
+#include "Library.hpp"
+#include "Mmap.hpp"
 
+#include <filesystem>
 #include <sf2cute.hpp>
 
+#include <algorithm>
 #include <cmath>
-#include <fstream>
-#include <ios>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <ostream>
 #include <string>
 #include <vector>
 
 using namespace sf2cute;
 using namespace std;
+using namespace filesystem;
 
 const double AttackTable[] = { 13122, 6546, 4356, 3261, 2604, 2163, 1851, 1617, 1434, 1287, 1167, 1068, 984, 912, 849, 795, 747, 702, 666, 630, 600, 570, 543, 519, 498, 477, 459, 441, 426, 411, 396, 384, 372, 360, 348, 336, 327, 318, 309, 300, 294, 285, 279, 270, 264, 258, 252, 246, 240, 234, 231, 225, 219, 216, 210, 207, 201, 198, 195, 192, 186, 183, 180, 177, 174, 171, 168, 165, 162, 159, 156, 153.5, 153, 150, 147, 144, 141.5, 141, 138, 135.5, 135, 132, 129.5, 129, 126, 123.5, 123, 120.5, 120, 117, 114.5, 114, 111.5, 111, 108.5, 108, 105.7, 105.35, 105, 102.5, 102, 99.5, 99, 96.7, 96.35, 96, 93.5, 93, 90, 87, 81, 75, 72, 69, 63, 60, 54, 48, 45, 39, 36, 30, 24, 21, 15, 12, 9, 6.1e-6 };
 const double HoldTable[] = { 6e-6, 1, 2, 4, 6, 9, 12, 16, 20, 25, 30, 36, 42, 49, 56, 64, 72, 81, 90, 100, 110, 121, 132, 144, 156, 169, 182, 196, 210, 225, 240, 256, 272, 289, 306, 324, 342, 361, 380, 400, 420, 441, 462, 484, 506, 529, 552, 576, 600, 625, 650, 676, 702, 729, 756, 784, 812, 841, 870, 900, 930, 961, 992, 1024, 1056, 1089, 1122, 1156, 1190, 1225, 1260, 1296, 1332, 1369, 1406, 1444, 1482, 1521, 1560, 1600, 1640, 1681, 1722, 1764, 1806, 1849, 1892, 1936, 1980, 2025, 2070, 2116, 2162, 2209, 2256, 2304, 2352, 2401, 2450, 2500, 2550, 2601, 2652, 2704, 2756, 2809, 2862, 2916, 2970, 3025, 3080, 3136, 3192, 3249, 3306, 3364, 3422, 3481, 3540, 3600, 3660, 3721, 3782, 3844, 3906, 3969, 4032, 4096 };
@@ -107,170 +114,193 @@ double ConvertSustain(uint8_t sustain)
 	}
 }
 
-Cbnk::Cbnk(const char* fileName, map<int, Cwar*>* cwars, bool p) : FileName(fileName), Cwars(cwars), P(p)
+CbnkSource::CbnkSource(Cwav* wave, uint16_t chan) : Wave(wave), Chan(chan)
 {
-	ifstream ifs(FileName, ios::binary | ios::ate);
+}
+
+SFSampleData CbnkSource::Load() const
+{
+	shared_ptr<const void> pcm = Wave->Pcm();
+
+	if (pcm != nullptr)
+	{
+		return SFSampleData{ pcm, Wave->Chans[Chan].Samples, Wave->Chans[Chan].Stride };
+	}
 
-	Length = ifs.tellg();
-	Data = new uint8_t[Length];
+	shared_ptr<vector<int16_t>> samples = make_shared<vector<int16_t>>(Wave->LoopEnd);
 
-	Common::Push(FileName, Data);
+	Wave->Decode(Chan, 1, samples->data(), 1);
 
-	ifs.seekg(0, ios::beg);
-	ifs.read(reinterpret_cast<char*>(Data), Length);
-	ifs.close();
+	return SFSampleData{ samples, samples->data(), 1 };
 }
 
-Cbnk::~Cbnk()
+// The SF2 only asks for a wave's samples as it writes them, so at most one is held that would not be held anyway
+static LibrarySample NewSample(SoundFont& sf2, const CbnkCwav& cwav, const string& name)
 {
-	Common::Pop();
+	LibrarySample sample;
 
-	delete[] Data;
+	if (cwav.ChanCount == 1)
+	{
+		sample.Left = sf2.NewSample(name, make_shared<CbnkSource>(cwav.Wave, 0), cwav.SampleCount, cwav.LoopStart, cwav.LoopEnd, cwav.SampleRate, cwav.Key, 0);
+	}
+	else
+	{
+		sample.Left = sf2.NewSample(name + "l", make_shared<CbnkSource>(cwav.Wave, 0), cwav.SampleCount, cwav.LoopStart, cwav.LoopEnd, cwav.SampleRate, cwav.Key, 0);
+		sample.Right = sf2.NewSample(name + "r", make_shared<CbnkSource>(cwav.Wave, 1), cwav.SampleCount, cwav.LoopStart, cwav.LoopEnd, cwav.SampleRate, cwav.Key, 0);
+
+		sample.Left->set_link(sample.Right);
+		sample.Right->set_link(sample.Left);
+
+		sample.Left->set_type(SFSampleLink::kLeftSample);
+		sample.Right->set_type(SFSampleLink::kRightSample);
+	}
+
+	return sample;
 }
 
-bool Cbnk::Convert(string cwarPath)
+Cbnk::Cbnk(const char* fileName, Index* resources, bool p) : FileName(fileName), Resources(resources), P(p)
 {
-	uint8_t* pos = Data;
+	File = new Mmap(FileName.c_str());
 
-	if (!Common::Assert(pos, 0x43424E4B, ReadFixLen(pos, 4, false))) { return false; }
-	if (!Common::Assert(pos, 0xFEFF, ReadFixLen(pos, 2))) { return false; }
-	if (!Common::Assert(pos, 0x20, ReadFixLen(pos, 2))) { return false; }
+	Length = File->Length;
+	Data = File->Data;
+}
 
-	uint32_t cbnkVersion = ReadFixLen(pos, 4);
+Cbnk::Cbnk(const char* fileName, uint8_t* data, streamoff length, Index* resources, bool p) : FileName(fileName), Length(length), Data(data), Resources(resources), P(p)
+{
+}
 
-	if (!Common::Assert<uint64_t>(pos, Length, ReadFixLen(pos, 4))) { return false; }
-	if (!Common::Assert(pos, 0x1, ReadFixLen(pos, 4))) { return false; }
-	if (!Common::Assert(pos, 0x5800, ReadFixLen(pos, 4))) { return false; }
+Cbnk::~Cbnk()
+{
+	delete File;
+}
 
-	uint32_t infoOffset = ReadFixLen(pos, 4);
-	uint32_t infoLength = ReadFixLen(pos, 4);
+vector<uint32_t> Cbnk::References(uint8_t* data, streamoff length)
+{
+	vector<uint32_t> cwars;
 
-	if (!Common::Assert(pos, 0x494E464F, ReadFixLen(pos, 4, false))) { return false; }
-	if (!Common::Assert<uint32_t>(pos, infoLength, ReadFixLen(pos, 4))) { return false; }
-	if (!Common::Assert(pos, 0x100, ReadFixLen(pos, 4))) { return false; }
+	// Only a quick look at the wave table, so anything malformed is left for Convert to report
+	uint64_t end = static_cast<uint64_t>(length);
 
-	uint32_t cwavOffset = ReadFixLen(pos, 4);
+	if (end < 0x1C)
+	{
+		return cwars;
+	}
 
-	if (!Common::Assert(pos, 0x101, ReadFixLen(pos, 4))) { return false; }
+	uint8_t* pos = data + 0x18;
 
-	uint32_t instOffset = ReadFixLen(pos, 4);
+	uint32_t infoOffset = Read<uint32_t>(pos);
 
-	pos = Data + infoOffset + 8 + cwavOffset;
+	if ((static_cast<uint64_t>(infoOffset) + 16) > end)
+	{
+		return cwars;
+	}
 
-	uint32_t cwavCount = ReadFixLen(pos, 4);
+	pos = data + infoOffset + 12;
 
-	vector<CbnkCwav> cwavs;
+	uint32_t cwavOffset = Read<uint32_t>(pos);
 
-	for (uint32_t i = 0; i < cwavCount; ++i)
+	if ((static_cast<uint64_t>(infoOffset) + 12 + cwavOffset) > end)
 	{
-		pos = Data + infoOffset + 8 + cwavOffset + 4 + (i * 8);
+		return cwars;
+	}
 
-		CbnkCwav cwav;
-		cwav.Cwar = ReadFixLen(pos, 4) - 0x5000000;
-		cwav.Id = ReadFixLen(pos, 4);
+	pos = data + infoOffset + 8 + cwavOffset;
+
+	uint32_t cwavCount = Read<uint32_t>(pos);
+
+	if ((static_cast<uint64_t>(infoOffset) + 12 + cwavOffset + (static_cast<uint64_t>(cwavCount) * 8)) > end)
+	{
+		return cwars;
+	}
 
-		size_t j = 0;
-		auto it = Cwars->begin();
+	for (uint32_t i = 0; i < cwavCount; ++i)
+	{
+		uint32_t cwar = Read<uint32_t>(pos) - 0x5000000;
+		uint32_t id = Read<uint32_t>(pos);
 
-		for (; it != Cwars->end(); ++it, ++j)
+		if ((id < 0xF000) && (find(cwars.begin(), cwars.end(), cwar) == cwars.end()))
 		{
-			if (j == cwav.Cwar)
-			{
-				break;
-			}
+			cwars.push_back(cwar);
 		}
+	}
 
-		if (cwav.Id < 0xF000)
-		{
-			ifstream ifs(cwarPath + "/" + it->second->FileName.substr(0, it->second->FileName.length() - 6) + "/" + to_string(cwav.Id) + ".wav", ios::binary | ios::ate);
+	return cwars;
+}
 
-			streamoff cwavLength = ifs.tellg();
-			uint8_t* cwavData = new uint8_t[cwavLength];
+bool Cbnk::Convert(path outPath)
+{
+	if (AlreadyShared)
+	{
+		return true;
+	}
 
-			Common::Push(string(to_string(cwav.Id) + ".wav"), cwavData);
+	Common::Push(FileName, Data, Length);
 
-			ifs.seekg(0, ios::beg);
-			ifs.read(reinterpret_cast<char*>(cwavData), cwavLength);
-			ifs.close();
+	bool result = Parse(outPath);
 
-			pos = cwavData;
+	Common::Pop();
 
-			if (!Common::Assert(pos, 0x52494646, ReadFixLen(pos, 4, false))) { return false; }
-			if (!Common::Assert<uint64_t>(pos, cwavLength - 8, ReadFixLen(pos, 4))) { return false; }
-			if (!Common::Assert(pos, 0x57415645, ReadFixLen(pos, 4, false))) { return false; }
-			if (!Common::Assert(pos, 0x666D7420, ReadFixLen(pos, 4, false))) { return false; }
-			if (!Common::Assert(pos, 0x10, ReadFixLen(pos, 4))) { return false; }
-			if (!Common::Assert(pos, 0x1, ReadFixLen(pos, 2))) { return false; }
+	return result;
+}
 
-			cwav.ChanCount = ReadFixLen(pos, 2);
-			cwav.SampleRate = ReadFixLen(pos, 4);
-			uint32_t byteRate = ReadFixLen(pos, 4);
-			uint16_t blockAlign = ReadFixLen(pos, 2);
-			uint16_t bitsPerSample = ReadFixLen(pos, 2);
+bool Cbnk::Parse(path outPath)
+{
+	uint8_t* pos = Data;
 
-			if (!Common::Assert(pos - 8, byteRate, (cwav.SampleRate * cwav.ChanCount) * (bitsPerSample / 8))) { return false; }
-			if (!Common::Assert<uint16_t>(pos - 4, blockAlign, cwav.ChanCount * (bitsPerSample / 8))) { return false; }
-			if (!Common::Assert(pos, 0x64617461, ReadFixLen(pos, 4, false))) { return false; }
+	if (!Common::Assert(pos, 0x43424E4B, Read<uint32_t, Endian::Big>(pos))) { return false; }
+	if (!Common::Assert(pos, 0xFEFF, Read<uint16_t>(pos))) { return false; }
+	if (!Common::Assert(pos, 0x20, Read<uint16_t>(pos))) { return false; }
 
-			uint32_t cwavDataLength = ReadFixLen(pos, 4);
+	uint32_t cbnkVersion = Read<uint32_t>(pos);
 
-			while (pos < (cwavData + 44 + cwavDataLength))
-			{
-				cwav.LeftSamples.push_back(ReadFixLen(pos, 2));
+	if (!Common::Assert<uint64_t>(pos, Length, Read<uint32_t>(pos))) { return false; }
+	if (!Common::Assert(pos, 0x1, Read<uint32_t>(pos))) { return false; }
+	if (!Common::Assert(pos, 0x5800, Read<uint32_t>(pos))) { return false; }
 
-				if (cwav.ChanCount == 2)
-				{
-					cwav.RightSamples.push_back(ReadFixLen(pos, 2));
-				}
-			}
+	uint32_t infoOffset = Read<uint32_t>(pos);
+	uint32_t infoLength = Read<uint32_t>(pos);
 
-			for (; pos < (cwavData + cwavLength); pos -= 3)
-			{
-				if (ReadFixLen(pos, 4, false) == 0x736D706C)
-				{
-					uint32_t smplLength = ReadFixLen(pos, 4);
-					uint32_t manufacturer = ReadFixLen(pos, 4);
-					uint32_t product = ReadFixLen(pos, 4);
-					uint32_t samplePeriod = ReadFixLen(pos, 4);
-					uint32_t midiUnityNote = ReadFixLen(pos, 4);
-					uint32_t midiPitchFraction = ReadFixLen(pos, 4);
-					uint32_t smpteFormat = ReadFixLen(pos, 4);
-					uint32_t smpteOffset = ReadFixLen(pos, 4);
-					uint32_t sampleLoops = ReadFixLen(pos, 4);
-					uint32_t samplerData = ReadFixLen(pos, 4);
-
-					vector<WaveSmpl> smpls;
-
-					for (uint32_t j = 0; j < sampleLoops; ++j)
-					{
-						WaveSmpl smpl{};
-						smpl.CuePointId = ReadFixLen(pos, 4);
-						smpl.Type = ReadFixLen(pos, 4);
-						smpl.Start = ReadFixLen(pos, 4);
-						smpl.End = ReadFixLen(pos, 4);
-						smpl.Fraction = ReadFixLen(pos, 4);
-						smpl.PlayCount = ReadFixLen(pos, 4);
-
-						smpls.push_back(smpl);
-					}
+	if (!Common::Assert(pos, 0x494E464F, Read<uint32_t, Endian::Big>(pos))) { return false; }
+	if (!Common::Assert<uint32_t>(pos, infoLength, Read<uint32_t>(pos))) { return false; }
+	if (!Common::Assert(pos, 0x100, Read<uint32_t>(pos))) { return false; }
 
-					cwav.Loop = true;
-					cwav.LoopStart = smpls[0].Start;
-					cwav.LoopEnd = smpls[0].End;
+	uint32_t cwavOffset = Read<uint32_t>(pos);
 
-					break;
-				}
-			}
+	if (!Common::Assert(pos, 0x101, Read<uint32_t>(pos))) { return false; }
 
-			if (!cwav.Loop)
-			{
-				cwav.LoopStart = 0;
-				cwav.LoopEnd = cwav.LeftSamples.size();
-			}
+	uint32_t instOffset = Read<uint32_t>(pos);
+
+	pos = Data + infoOffset + 8 + cwavOffset;
+
+	uint32_t cwavCount = Read<uint32_t>(pos);
+
+	vector<CbnkCwav> cwavs;
+
+	for (uint32_t i = 0; i < cwavCount; ++i)
+	{
+		pos = Data + infoOffset + 8 + cwavOffset + 4 + (i * 8);
+
+		CbnkCwav cwav;
+		cwav.Cwar = Read<uint32_t>(pos) - 0x5000000;
+		cwav.Id = Read<uint32_t>(pos);
 
-			Common::Pop();
+		Cwar* cwar = Resources->FindCwar(cwav.Cwar);
 
-			delete[] cwavData;
+		if (cwav.Id >= 0xF000)
+		{
+			cwav.Exists = false;
+		}
+		else if ((cwar == nullptr) || (cwav.Id >= cwar->Cwavs.size()))
+		{
+			Common::Warning(pos - 4, "CWAV " + to_string(cwav.Id) + " of CWAR " + to_string(cwav.Cwar) + " does not exist");
+
+			cwav.Exists = false;
+		}
+		else
+		{
+			cwav.Offset = pos - 4;
+			cwav.Wave = cwar->Cwavs[cwav.Id];
 		}
 
 		cwavs.push_back(cwav);
@@ -278,7 +308,7 @@ bool Cbnk::Convert(string cwarPath)
 
 	pos = Data + infoOffset + 8 + instOffset;
 
-	uint32_t instCount = ReadFixLen(pos, 4);
+	uint32_t instCount = Read<uint32_t>(pos);
 
 	vector<CbnkInst> insts;
 
@@ -286,12 +316,12 @@ bool Cbnk::Convert(string cwarPath)
 	{
 		CbnkInst inst;
 
-		if (ReadFixLen(pos, 4) != 0x5900)
+		if (Read<uint32_t>(pos) != 0x5900)
 		{
 			inst.Exists = false;
 		}
 
-		inst.Offset = Data + infoOffset + 24 + ReadFixLen(pos, 4);
+		inst.Offset = Data + infoOffset + 24 + Read<uint32_t>(pos);
 
 		insts.push_back(inst);
 	}
@@ -305,9 +335,9 @@ bool Cbnk::Convert(string cwarPath)
 
 		pos = insts[i].Offset;
 
-		uint32_t instType = ReadFixLen(pos, 4);
+		uint32_t instType = Read<uint32_t>(pos);
 
-		if (!Common::Assert(pos, 0x8, ReadFixLen(pos, 4))) { return false; }
+		if (!Common::Assert(pos, 0x8, Read<uint32_t>(pos))) { return false; }
 
 		switch (instType)
 		{
@@ -326,13 +356,13 @@ bool Cbnk::Convert(string cwarPath)
 
 			case 0x6001:
 			{
-				insts[i].NoteCount = ReadFixLen(pos, 4);
+				insts[i].NoteCount = Read<uint32_t>(pos);
 
 				for (uint32_t j = 0; j < insts[i].NoteCount; ++j)
 				{
 					CbnkNote note{};
 					note.StartNote = j == 0 ? 0 : insts[i].Notes[j - 1].EndNote + 1;
-					note.EndNote = ReadFixLen(pos, 1);
+					note.EndNote = Read<uint8_t>(pos);
 
 					insts[i].Notes.push_back(note);
 				}
@@ -341,7 +371,10 @@ bool Cbnk::Convert(string cwarPath)
 
 				if (padding)
 				{
-					if (!Common::Assert(pos, 0x0, ReadFixLen(pos, 4 - padding))) { return false; }
+					for (uint8_t j = padding; j < 4; ++j)
+					{
+						if (!Common::Assert(pos, 0x0, Read<uint8_t>(pos))) { return false; }
+					}
 				}
 
 				break;
@@ -349,7 +382,7 @@ bool Cbnk::Convert(string cwarPath)
 
 			case 0x6002:
 			{
-				insts[i].NoteCount = ReadFixLen(pos, 2, false) + 1;
+				insts[i].NoteCount = Read<uint16_t, Endian::Big>(pos) + 1;
 
 				for (uint32_t j = 0; j < insts[i].NoteCount; ++j)
 				{
@@ -360,7 +393,7 @@ bool Cbnk::Convert(string cwarPath)
 					insts[i].Notes.push_back(note);
 				}
 
-				if (!Common::Assert(pos, 0x0, ReadFixLen(pos, 2))) { return false; }
+				if (!Common::Assert(pos, 0x0, Read<uint16_t>(pos))) { return false; }
 
 				insts[i].IsDrumKit = true;
 
@@ -377,12 +410,12 @@ bool Cbnk::Convert(string cwarPath)
 
 		for (uint32_t j = 0; j < insts[i].NoteCount; ++j)
 		{
-			if (ReadFixLen(pos, 4) != 0x5901)
+			if (Read<uint32_t>(pos) != 0x5901)
 			{
 				insts[i].Notes[j].Exists = false;
 			}
 
-			insts[i].Notes[j].Offset = insts[i].Offset + 8 + ReadFixLen(pos, 4);
+			insts[i].Notes[j].Offset = insts[i].Offset + 8 + Read<uint32_t>(pos);
 		}
 
 		for (uint32_t j = 0; j < insts[i].NoteCount; ++j)
@@ -394,21 +427,21 @@ bool Cbnk::Convert(string cwarPath)
 
 			pos = insts[i].Notes[j].Offset;
 
-			uint32_t id = ReadFixLen(pos, 4);
+			uint32_t id = Read<uint32_t>(pos);
 
-			if (!Common::Assert(pos, 0x8, ReadFixLen(pos, 4))) { return false; }
-			Common::Analyse("Note 0x08", ReadFixLen(pos, 4));
-			Common::Analyse("Note 0x0C", ReadFixLen(pos, 4));
+			if (!Common::Assert(pos, 0x8, Read<uint32_t>(pos))) { return false; }
+			Common::Analyse("Note 0x08", Read<uint32_t>(pos));
+			Common::Analyse("Note 0x0C", Read<uint32_t>(pos));
 
 			if (id == 0x6001)
 			{
-				Common::Analyse("Note 0x6001 0x10", ReadFixLen(pos, 4));
-				Common::Analyse("Note 0x6001 0x14", ReadFixLen(pos, 4));
-				Common::Analyse("Note 0x6001 0x18", ReadFixLen(pos, 4));
-				Common::Analyse("Note 0x6001 0x1C", ReadFixLen(pos, 4));
+				Common::Analyse("Note 0x6001 0x10", Read<uint32_t>(pos));
+				Common::Analyse("Note 0x6001 0x14", Read<uint32_t>(pos));
+				Common::Analyse("Note 0x6001 0x18", Read<uint32_t>(pos));
+				Common::Analyse("Note 0x6001 0x1C", Read<uint32_t>(pos));
 			}
 
-			uint32_t cwav = ReadFixLen(pos, 4);
+			uint32_t cwav = Read<uint32_t>(pos);
 
 			if (cwav < cwavs.size())
 			{
@@ -421,64 +454,156 @@ bool Cbnk::Convert(string cwarPath)
 				insts[i].Notes[j].Cwav = &cwavs[0];
 			}
 
-			Common::Analyse("Note 0x14", ReadFixLen(pos, 4));
+			insts[i].Notes[j].Cwav->Referenced = true;
+
+			Common::Analyse("Note 0x14", Read<uint32_t>(pos));
 
-			insts[i].Notes[j].RootKey = ReadFixLen(pos, 4);
+			insts[i].Notes[j].RootKey = Read<uint32_t>(pos);
 			insts[i].Notes[j].Cwav->Key = insts[i].Notes[j].RootKey;
-			insts[i].Notes[j].Volume = ReadFixLen(pos, 4);
-			insts[i].Notes[j].Pan = ReadFixLen(pos, 4);
+			insts[i].Notes[j].Volume = Read<uint32_t>(pos);
+			insts[i].Notes[j].Pan = Read<uint32_t>(pos);
+
+			Common::Analyse("Note 0x24", Read<uint32_t>(pos));
+			Common::Analyse("Note 0x28", Read<uint16_t>(pos));
+
+			insts[i].Notes[j].Interpolation = Read<uint8_t>(pos);
+
+			if (!Common::Assert(pos, 0x0, Read<uint8_t>(pos))) { return false; }
+			Common::Analyse("Note 0x2C", Read<uint32_t>(pos));
+			Common::Analyse("Note 0x30", Read<uint32_t>(pos));
+			Common::Analyse("Note 0x34", Read<uint32_t>(pos));
+
+			insts[i].Notes[j].Attack = Read<uint8_t>(pos);
+			insts[i].Notes[j].Decay = Read<uint8_t>(pos);
+			insts[i].Notes[j].Sustain = Read<uint8_t>(pos);
+			insts[i].Notes[j].Hold = Read<uint8_t>(pos);
+			insts[i].Notes[j].Release = Read<uint8_t>(pos);
+
+			if (!Common::Assert(pos, 0x0, Read<uint32_t, Endian::Little, 3>(pos))) { return false; }
+		}
+	}
+
+	for (uint32_t i = 0; i < cwavCount; ++i)
+	{
+		if (!cwavs[i].Exists)
+		{
+			continue;
+		}
+
+		if (Common::OnDemand && !cwavs[i].Referenced)
+		{
+			cwavs[i].Exists = false;
 
-			Common::Analyse("Note 0x24", ReadFixLen(pos, 4));
-			Common::Analyse("Note 0x28", ReadFixLen(pos, 2));
+			continue;
+		}
 
-			insts[i].Notes[j].Interpolation = ReadFixLen(pos, 1);
+		Cwav* wave = cwavs[i].Wave;
+
+		// The wave reports its own errors, so a bank using it only notes that it is missing
+		if (!wave->Demand() || (wave->ChanCount == 0))
+		{
+			Common::Warning(cwavs[i].Offset, "CWAV " + to_string(cwavs[i].Id) + " of CWAR " + to_string(cwavs[i].Cwar) + " does not exist");
 
-			if (!Common::Assert(pos, 0x0, ReadFixLen(pos, 1))) { return false; }
-			Common::Analyse("Note 0x2C", ReadFixLen(pos, 4));
-			Common::Analyse("Note 0x30", ReadFixLen(pos, 4));
-			Common::Analyse("Note 0x34", ReadFixLen(pos, 4));
+			cwavs[i].Exists = false;
+
+			continue;
+		}
+
+		cwavs[i].ChanCount = wave->ChanCount;
+		cwavs[i].SampleRate = wave->SampleRate;
+		cwavs[i].SampleMode = wave->SampleMode;
+
+		cwavs[i].SampleCount = wave->LoopEnd;
+
+		if ((wave->SampleMode % 2) != 0)
+		{
+			cwavs[i].Loop = true;
+			cwavs[i].LoopStart = wave->LoopStart;
+			cwavs[i].LoopEnd = wave->LoopEnd;
+		}
+		else
+		{
+			cwavs[i].LoopStart = 0;
+			cwavs[i].LoopEnd = cwavs[i].SampleCount;
+		}
+	}
 
-			insts[i].Notes[j].Attack = ReadFixLen(pos, 1);
-			insts[i].Notes[j].Decay = ReadFixLen(pos, 1);
-			insts[i].Notes[j].Sustain = ReadFixLen(pos, 1);
-			insts[i].Notes[j].Hold = ReadFixLen(pos, 1);
-			insts[i].Notes[j].Release = ReadFixLen(pos, 1);
+	Library* shared = Shared;
 
-			if (!Common::Assert(pos, 0x0, ReadFixLen(pos, 3))) { return false; }
+	// Drum kits take the bank 128 above their melodic one, so only the first 128 banks fit
+	if ((shared != nullptr) && (Number >= 128))
+	{
+		if (Number != Index::None)
+		{
+			Common::Warning(Data, "Too many banks to share one SF2");
 		}
+		else
+		{
+			Common::Warning(Data, "Bank is not listed in the CSAR, so it gets its own SF2");
+		}
+
+		shared = nullptr;
 	}
 
-	SoundFont sf2;
-	sf2.set_sound_engine("EMU8000");
-	sf2.set_bank_name(FileName.substr(0, FileName.length() - 6));
-	sf2.set_rom_name("ROM");
-	sf2.set_software("Caesar");
+	SoundFont own;
+	unique_lock<mutex> lock;
 
-	map<uint32_t, shared_ptr<SFSample>> leftSamples;
-	map<uint32_t, shared_ptr<SFSample>> rightSamples;
+	if (shared == nullptr)
+	{
+		own.set_sound_engine("EMU8000");
+		own.set_bank_name(FileName.substr(0, FileName.length() - 6));
+		own.set_rom_name("ROM");
+		own.set_software("Caesar");
+	}
+	else
+	{
+		lock = unique_lock<mutex>(shared->Mutex);
+	}
+
+	SoundFont& sf2 = shared == nullptr ? own : shared->Sf2;
+
+	map<uint32_t, LibrarySample> samples;
 
 	for (uint32_t i = 0; i < cwavCount; ++i)
 	{
-		if (cwavs[i].Id >= 0xF000)
+		if (!cwavs[i].Exists)
 		{
 			continue;
 		}
 
-		if (cwavs[i].ChanCount == 1)
+		if (shared == nullptr)
 		{
-			leftSamples[cwavs[i].Id] = sf2.NewSample(to_string(cwavs[i].Id), cwavs[i].LeftSamples, cwavs[i].LoopStart, cwavs[i].LoopEnd, cwavs[i].SampleRate, cwavs[i].Key, 0);
+			samples[cwavs[i].Id] = NewSample(sf2, cwavs[i], to_string(cwavs[i].Id));
+
+			continue;
 		}
-		else
+
+		pair<uint32_t, uint32_t> wave(cwavs[i].Cwar, cwavs[i].Id);
+
+		auto it = shared->Waves.find(wave);
+
+		if (it != shared->Waves.end())
 		{
-			leftSamples[cwavs[i].Id] = sf2.NewSample(to_string(cwavs[i].Id) + "l", cwavs[i].LeftSamples, cwavs[i].LoopStart, cwavs[i].LoopEnd, cwavs[i].SampleRate, cwavs[i].Key, 0);
-			rightSamples[cwavs[i].Id] = sf2.NewSample(to_string(cwavs[i].Id) + "r", cwavs[i].RightSamples, cwavs[i].LoopStart, cwavs[i].LoopEnd, cwavs[i].SampleRate, cwavs[i].Key, 0);
+			samples[cwavs[i].Id] = it->second;
+
+			continue;
+		}
+
+		// The same wave can sit in several wave archives, so samples are also matched by their encoded contents, as they are only decoded once the SF2 is written
+		uint32_t format[] = { cwavs[i].ChanCount, cwavs[i].SampleRate, cwavs[i].LoopStart, cwavs[i].LoopEnd };
+
+		uint64_t hash = Hash64(reinterpret_cast<uint8_t*>(format), sizeof(format));
+		hash = Hash64(cwavs[i].Wave->Data, static_cast<size_t>(cwavs[i].Wave->Length), hash);
 
-			leftSamples[cwavs[i].Id]->set_link(rightSamples[cwavs[i].Id]);
-			rightSamples[cwavs[i].Id]->set_link(leftSamples[cwavs[i].Id]);
+		auto content = shared->Contents.find(hash);
 
-			leftSamples[cwavs[i].Id]->set_type(SFSampleLink::kLeftSample);
-			rightSamples[cwavs[i].Id]->set_type(SFSampleLink::kRightSample);
+		if (content == shared->Contents.end())
+		{
+			content = shared->Contents.emplace(hash, NewSample(sf2, cwavs[i], to_string(cwavs[i].Cwar) + "_" + to_string(cwavs[i].Id))).first;
 		}
+
+		shared->Waves[wave] = content->second;
+		samples[cwavs[i].Id] = content->second;
 	}
 
 	vector<shared_ptr<SFInstrument>> instruments;
@@ -491,19 +616,8 @@ bool Cbnk::Convert(string cwarPath)
 
 			for (uint32_t j = 0; j < insts[i].NoteCount; ++j)
 			{
-				if ((insts[i].Notes[j].Exists) && (insts[i].Notes[j].Cwav->Id < 0xF000))
+				if ((insts[i].Notes[j].Exists) && (insts[i].Notes[j].Cwav->Exists))
 				{
-					size_t k = 0;
-					auto it = Cwars->begin();
-
-					for (; it != Cwars->end(); ++it, ++k)
-					{
-						if (k == insts[i].Notes[j].Cwav->Cwar)
-						{
-							break;
-						}
-					}
-
 					SFGeneratorItem keyRange(SFGenerator::kKeyRange, RangesType(insts[i].Notes[j].StartNote, insts[i].Notes[j].EndNote));
 					SFGeneratorItem overridingRootKey(SFGenerator::kOverridingRootKey, insts[i].Notes[j].RootKey);
 					SFGeneratorItem initialAttenuation(SFGenerator::kInitialAttenuation, ConvertVolume(insts[i].Notes[j].Volume));
@@ -513,11 +627,11 @@ bool Cbnk::Convert(string cwarPath)
 					SFGeneratorItem decayVolEnv(SFGenerator::kDecayVolEnv, ConvertDecay(insts[i].Notes[j].Decay, insts[i].Notes[j].Sustain));
 					SFGeneratorItem releaseVolEnv(SFGenerator::kReleaseVolEnv, ConvertRelease(insts[i].Notes[j].Release, insts[i].Notes[j].Sustain));
 					SFGeneratorItem sustainVolEnv(SFGenerator::kSustainVolEnv, ConvertSustain(insts[i].Notes[j].Sustain));
-					SFGeneratorItem sampleModes(SFGenerator::kSampleModes, it->second->Cwavs[insts[i].Notes[j].Cwav->Id]->SampleMode);
+					SFGeneratorItem sampleModes(SFGenerator::kSampleModes, insts[i].Notes[j].Cwav->SampleMode);
 
 					if (insts[i].Notes[j].Cwav->ChanCount == 1)
 					{
-						instrumentZones.push_back(SFInstrumentZone(leftSamples[insts[i].Notes[j].Cwav->Id], vector<SFGeneratorItem> { keyRange, overridingRootKey, initialAttenuation, pan, attackVolEnv, holdVolEnv, decayVolEnv, releaseVolEnv, sustainVolEnv, sampleModes }, vector<SFModulatorItem> { }));
+						instrumentZones.push_back(SFInstrumentZone(samples[insts[i].Notes[j].Cwav->Id].Left, vector<SFGeneratorItem> { keyRange, overridingRootKey, initialAttenuation, pan, attackVolEnv, holdVolEnv, decayVolEnv, releaseVolEnv, sustainVolEnv, sampleModes }, vector<SFModulatorItem> { }));
 					}
 					else
 					{
@@ -526,16 +640,16 @@ bool Cbnk::Convert(string cwarPath)
 							SFGeneratorItem left(SFGenerator::kPan, -500);
 							SFGeneratorItem right(SFGenerator::kPan, 500);
 
-							instrumentZones.push_back(SFInstrumentZone(leftSamples[insts[i].Notes[j].Cwav->Id], vector<SFGeneratorItem> { keyRange, overridingRootKey, initialAttenuation, left, attackVolEnv, holdVolEnv, decayVolEnv, releaseVolEnv, sustainVolEnv, sampleModes }, vector<SFModulatorItem> { }));
-							instrumentZones.push_back(SFInstrumentZone(rightSamples[insts[i].Notes[j].Cwav->Id], vector<SFGeneratorItem> { keyRange, overridingRootKey, initialAttenuation, right, attackVolEnv, holdVolEnv, decayVolEnv, releaseVolEnv, sustainVolEnv, sampleModes }, vector<SFModulatorItem> { }));
+							instrumentZones.push_back(SFInstrumentZone(samples[insts[i].Notes[j].Cwav->Id].Left, vector<SFGeneratorItem> { keyRange, overridingRootKey, initialAttenuation, left, attackVolEnv, holdVolEnv, decayVolEnv, releaseVolEnv, sustainVolEnv, sampleModes }, vector<SFModulatorItem> { }));
+							instrumentZones.push_back(SFInstrumentZone(samples[insts[i].Notes[j].Cwav->Id].Right, vector<SFGeneratorItem> { keyRange, overridingRootKey, initialAttenuation, right, attackVolEnv, holdVolEnv, decayVolEnv, releaseVolEnv, sustainVolEnv, sampleModes }, vector<SFModulatorItem> { }));
 						}
 						else
 						{
 							SFGeneratorItem left(SFGenerator::kPan, ((static_cast<double>(insts[i].Notes[j].Pan) / 128.0f) * 500) - 500);
 							SFGeneratorItem right(SFGenerator::kPan, (static_cast<double>(insts[i].Notes[j].Pan) / 128.0f) * 500);
 
-							instrumentZones.push_back(SFInstrumentZone(leftSamples[insts[i].Notes[j].Cwav->Id], vector<SFGeneratorItem> { keyRange, overridingRootKey, initialAttenuation, left, attackVolEnv, holdVolEnv, decayVolEnv, releaseVolEnv, sustainVolEnv, sampleModes }, vector<SFModulatorItem> { }));
-							instrumentZones.push_back(SFInstrumentZone(rightSamples[insts[i].Notes[j].Cwav->Id], vector<SFGeneratorItem> { keyRange, overridingRootKey, initialAttenuation, right, attackVolEnv, holdVolEnv, decayVolEnv, releaseVolEnv, sustainVolEnv, sampleModes }, vector<SFModulatorItem> { }));
+							instrumentZones.push_back(SFInstrumentZone(samples[insts[i].Notes[j].Cwav->Id].Left, vector<SFGeneratorItem> { keyRange, overridingRootKey, initialAttenuation, left, attackVolEnv, holdVolEnv, decayVolEnv, releaseVolEnv, sustainVolEnv, sampleModes }, vector<SFModulatorItem> { }));
+							instrumentZones.push_back(SFInstrumentZone(samples[insts[i].Notes[j].Cwav->Id].Right, vector<SFGeneratorItem> { keyRange, overridingRootKey, initialAttenuation, right, attackVolEnv, holdVolEnv, decayVolEnv, releaseVolEnv, sustainVolEnv, sampleModes }, vector<SFModulatorItem> { }));
 						}
 					}
 				}
@@ -543,7 +657,7 @@ bool Cbnk::Convert(string cwarPath)
 
 			if (!instrumentZones.empty())
 			{
-				instruments.push_back(sf2.NewInstrument(to_string(i), instrumentZones));
+				instruments.push_back(sf2.NewInstrument(shared == nullptr ? to_string(i) : to_string(Number) + "_" + to_string(i), instrumentZones));
 			}
 			else
 			{
@@ -560,13 +674,17 @@ bool Cbnk::Convert(string cwarPath)
 	{
 		if (insts[i].Exists && (instruments[i] != nullptr))
 		{
-			sf2.NewPreset(instruments[i]->name(), i, !insts[i].IsDrumKit ? 0 : 128, vector<SFPresetZone> { SFPresetZone(instruments[i]) });
+			sf2.NewPreset(instruments[i]->name(), i, (!insts[i].IsDrumKit ? 0 : 128) + (shared == nullptr ? 0 : Number), vector<SFPresetZone> { SFPresetZone(instruments[i]) });
 		}
 	}
 
-	ofstream ofs(FileName.substr(0, FileName.length() - 5).append("sf2"), ios::binary);
-	sf2.Write(ofs);
-	ofs.close();
+	// The shared SF2 is written once every bank has added to it
+	if (shared != nullptr)
+	{
+		return true;
+	}
+
+	Common::Write(outPath / FileName.substr(0, FileName.length() - 5).append("sf2"), sf2.GetFileSize(), [&sf2](ostream& out) { sf2.Write(out); });
 
 	return true;
 }
@@ -1,38 +1,47 @@
 #pragma once
 
 #include "Cwar.hpp"
+#include "Index.hpp"
+#include "Library.hpp"
+#include "Mmap.hpp"
 
+#include <filesystem>
 #include <ios>
 #include <cstdint>
+#include <memory>
 #include <string>
-#include <map>
 #include <vector>
 
 struct CbnkCwav
 {
+	bool Exists = true;
+
 	uint32_t Cwar;
 	uint32_t Id;
 	uint32_t Key;
+	uint8_t* Offset;
+
+	Cwav* Wave = nullptr;
+	bool Referenced = false;
 	
 	uint16_t ChanCount;
 	uint32_t SampleRate;
+	uint8_t SampleMode;
 
-	std::vector<int16_t> LeftSamples;
-	std::vector<int16_t> RightSamples;
+	uint32_t SampleCount;
 
 	bool Loop = false;
 	uint32_t LoopStart;
 	uint32_t LoopEnd;
 };
 
-struct WaveSmpl
+struct CbnkSource : sf2cute::SFSampleSource
 {
-	uint32_t CuePointId;
-	uint32_t Type;
-	uint32_t Start;
-	uint32_t End;
-	uint32_t Fraction;
-	uint32_t PlayCount;
+	Cwav* Wave;
+	uint16_t Chan;
+
+	CbnkSource(Cwav* wave, uint16_t chan);
+	sf2cute::SFSampleData Load() const override;
 };
 
 struct CbnkNote
@@ -70,11 +79,20 @@ struct Cbnk
 	std::string FileName;
 	std::streamoff Length;
 	uint8_t* Data = nullptr;
+	Mmap* File = nullptr;
 
-	std::map<int, Cwar*>* Cwars;
+	Index* Resources;
 	bool P;
 
-	Cbnk(const char* fileName, std::map<int, Cwar*>* cwars, bool p);
+	Library* Shared = nullptr;
+	uint32_t Number = Index::None;
+	bool AlreadyShared = false;
+
+	Cbnk(const char* fileName, Index* resources, bool p);
+	Cbnk(const char* fileName, uint8_t* data, std::streamoff length, Index* resources, bool p);
 	~Cbnk();
-	bool Convert(std::string cwarPath);
+	bool Convert(std::filesystem::path outPath);
+	bool Parse(std::filesystem::path outPath);
+
+	static std::vector<uint32_t> References(uint8_t* data, std::streamoff length);
 };
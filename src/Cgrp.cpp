@@ -3,29 +3,32 @@
 #include "Common.hpp"
 #include "Cseq.hpp"
 #include "Cwar.hpp"
+#include "Index.hpp"
+#include "Library.hpp"
+#include "Mmap.hpp"
+#include "Pool.hpp"
 
 #include <cstdint>
 #include <filesystem>
-#include <fstream>
-#include <map>
 #include <string>
 #include <vector>
 
 using namespace std;
 using namespace filesystem;
 
-Cgrp::Cgrp(const char* fileName, map<int, Cwar*>* cwars, const map<int, bool>& cseqsFromCsar, bool p) : FileName(fileName), Cwars(cwars), CseqsFromCsar(cseqsFromCsar), P(p)
+Cgrp::Cgrp(const char* fileName, Index* resources, bool p, Pool* workers) : FileName(fileName), Resources(resources), P(p), Workers(workers)
 {
-	ifstream ifs(FileName, ios::binary | ios::ate);
+	File = new Mmap(FileName.c_str());
 
-	Length = ifs.tellg();
-	Data = new uint8_t[Length];
+	Length = File->Length;
+	Data = File->Data;
 
-	Common::Push(FileName, Data);
+	Common::Push(FileName, Data, Length);
+}
 
-	ifs.seekg(0, ios::beg);
-	ifs.read(reinterpret_cast<char*>(Data), Length);
-	ifs.close();
+Cgrp::Cgrp(const char* fileName, uint8_t* data, streamoff length, Index* resources, bool p, Pool* workers) : FileName(fileName), Length(length), Data(data), Resources(resources), P(p), Workers(workers)
+{
+	Common::Push(FileName, Data, Length);
 }
 
 Cgrp::~Cgrp()
@@ -40,24 +43,29 @@ Cgrp::~Cgrp()
 		delete cbnk;
 	}
 
+	for (auto cwar : Cwars)
+	{
+		delete cwar;
+	}
+
 	Common::Pop();
 
-	delete[] Data;
+	delete File;
 }
 
-bool Cgrp::Extract()
+bool Cgrp::Extract(path outPath)
 {
 	uint8_t* pos = Data;
 
-	if (!Common::Assert(pos, 0x43475250, ReadFixLen(pos, 4, false))) { return false; }
-	if (!Common::Assert(pos, 0xFEFF, ReadFixLen(pos, 2))) { return false; }
-	if (!Common::Assert(pos, 0x40, ReadFixLen(pos, 2))) { return false; }
+	if (!Common::Assert(pos, 0x43475250, Read<uint32_t, Endian::Big>(pos))) { return false; }
+	if (!Common::Assert(pos, 0xFEFF, Read<uint16_t>(pos))) { return false; }
+	if (!Common::Assert(pos, 0x40, Read<uint16_t>(pos))) { return false; }
 
-	uint32_t cgrpVersion = ReadFixLen(pos, 4);
+	uint32_t cgrpVersion = Read<uint32_t>(pos);
 
-	if (!Common::Assert<uint64_t>(pos, Length, ReadFixLen(pos, 4))) { return false; }
+	if (!Common::Assert<uint64_t>(pos, Length, Read<uint32_t>(pos))) { return false; }
 
-	uint32_t chunkCount = ReadFixLen(pos, 4);
+	uint32_t chunkCount = Read<uint32_t>(pos);
 
 	uint32_t infoOffset = 0;
 	uint32_t infoLength = 0;
@@ -70,25 +78,25 @@ bool Cgrp::Extract()
 
 	for (uint32_t i = 0; i < chunkCount; ++i)
 	{
-		uint32_t chunkId = ReadFixLen(pos, 4);
+		uint32_t chunkId = Read<uint32_t>(pos);
 
 		switch (chunkId)
 		{
 			case 0x7800:
-				infoOffset = ReadFixLen(pos, 4);
-				infoLength = ReadFixLen(pos, 4);
+				infoOffset = Read<uint32_t>(pos);
+				infoLength = Read<uint32_t>(pos);
 
 				break;
 
 			case 0x7801:
-				fileOffset = ReadFixLen(pos, 4);
-				fileLength = ReadFixLen(pos, 4);
+				fileOffset = Read<uint32_t>(pos);
+				fileLength = Read<uint32_t>(pos);
 
 				break;
 
 			case 0x7802:
-				infxOffset = ReadFixLen(pos, 4);
-				infxLength = ReadFixLen(pos, 4);
+				infxOffset = Read<uint32_t>(pos);
+				infxLength = Read<uint32_t>(pos);
 
 				break;
 
@@ -103,18 +111,18 @@ bool Cgrp::Extract()
 
 	pos = Data + infoOffset;
 
-	if (!Common::Assert(pos, 0x494E464F, ReadFixLen(pos, 4, false))) { return false; }
-	if (!Common::Assert<uint32_t>(pos, infoLength, ReadFixLen(pos, 4))) { return false; }
+	if (!Common::Assert(pos, 0x494E464F, Read<uint32_t, Endian::Big>(pos))) { return false; }
+	if (!Common::Assert<uint32_t>(pos, infoLength, Read<uint32_t>(pos))) { return false; }
 
-	uint32_t fileCount = ReadFixLen(pos, 4);
+	uint32_t fileCount = Read<uint32_t>(pos);
 
 	vector<uint8_t*> fileOffsets;
 
 	for (uint32_t i = 0; i < fileCount; ++i)
 	{
-		if (!Common::Assert(pos, 0x7900, ReadFixLen(pos, 4))) { return false; }
+		if (!Common::Assert(pos, 0x7900, Read<uint32_t>(pos))) { return false; }
 
-		fileOffsets.push_back(Data + infoOffset + 8 + ReadFixLen(pos, 4));
+		fileOffsets.push_back(Data + infoOffset + 8 + Read<uint32_t>(pos));
 	}
 
 	vector<CgrpFile> files;
@@ -122,9 +130,17 @@ bool Cgrp::Extract()
 	for (uint32_t i = 0; i < fileCount; ++i)
 	{
 		CgrpFile file{};
-		file.Id = ReadFixLen(pos, 4);
-		file.Offset = ReadFixLen(pos, 4) == 0x1F00 ? Data + fileOffset + 8 + ReadFixLen(pos, 4) : nullptr;
-		file.Length = ReadFixLen(pos, 4);
+		file.Id = Read<uint32_t>(pos);
+
+		if (file.Id >= Resources->Files.size())
+		{
+			Common::Error(pos - 4, "A valid file identifier", file.Id);
+
+			return false;
+		}
+
+		file.Offset = Read<uint32_t>(pos) == 0x1F00 ? Data + fileOffset + 8 + Read<uint32_t>(pos) : nullptr;
+		file.Length = Read<uint32_t>(pos);
 
 		files.push_back(file);
 	}
@@ -136,14 +152,14 @@ bool Cgrp::Extract()
 			continue;
 		}
 
-		if (CseqsFromCsar[files[i].Id] == true)
+		if (Resources->IsFileCseq(files[i].Id))
 		{
 			continue;
 		}
 
 		pos = files[i].Offset;
 
-		uint32_t fileId = ReadFixLen(pos, 4, false);
+		uint32_t fileId = Read<uint32_t, Endian::Big>(pos);
 
 		switch (fileId)
 		{
@@ -151,30 +167,36 @@ bool Cgrp::Extract()
 			{
 				pos += 8;
 
-				uint32_t cwarLength = ReadFixLen(pos, 4);
+				uint32_t cwarLength = Read<uint32_t>(pos);
 
 				pos -= 16;
 
-				create_directory(to_string(files[i].Id));
-				current_path(to_string(files[i].Id));
+				Common::Directory(outPath / to_string(files[i].Id));
 
-				ofstream ofs(string(to_string(files[i].Id) + ".bcwar"), ofstream::binary);
-				ofs.write(reinterpret_cast<const char*>(pos), cwarLength);
-				ofs.close();
+				if (Common::DumpFiles)
+				{
+					Common::Write(outPath / to_string(files[i].Id) / (to_string(files[i].Id) + ".bcwar"), pos, cwarLength);
+				}
 
-				(*Cwars)[files[i].Id] = new Cwar(string(to_string(files[i].Id) + ".bcwar").c_str());
+				Cwar* cwar = new Cwar(string(to_string(files[i].Id) + ".bcwar").c_str(), pos, cwarLength, Workers);
 
-				current_path("..");
+				uint32_t index = Resources->FindFileCwar(files[i].Id);
 
-				current_path(((*Cwars)[files[i].Id]->FileName.substr(0, (*Cwars)[files[i].Id]->FileName.length() - 6)));
+				// A wave archive the CSAR only names is filled in for the banks that refer to it, while any other stays with the group
+				if ((index != Index::None) && (Resources->Cwars[index] == nullptr))
+				{
+					Resources->Cwars[index] = cwar;
+				}
+				else
+				{
+					Cwars.push_back(cwar);
+				}
 
-				if (!(*Cwars)[files[i].Id]->Extract())
+				if (!cwar->Extract(outPath / to_string(files[i].Id)))
 				{
 					return false;
 				}
 
-				current_path("..");
-
 				break;
 			}
 
@@ -182,20 +204,29 @@ bool Cgrp::Extract()
 			{
 				pos += 8;
 
-				uint32_t cbnkLength = ReadFixLen(pos, 4);
+				uint32_t cbnkLength = Read<uint32_t>(pos);
 
 				pos -= 16;
 
-				create_directory(to_string(files[i].Id));
-				current_path(to_string(files[i].Id));
+				Common::Directory(outPath / to_string(files[i].Id));
 
-				ofstream ofs(string(to_string(files[i].Id) + ".bcbnk"), ofstream::binary);
-				ofs.write(reinterpret_cast<const char*>(pos), cbnkLength);
-				ofs.close();
+				if (Common::DumpFiles)
+				{
+					Common::Write(outPath / to_string(files[i].Id) / (to_string(files[i].Id) + ".bcbnk"), pos, cbnkLength);
+				}
 
-				Cbnks.push_back(new Cbnk(string(to_string(files[i].Id) + ".bcbnk").c_str(), Cwars, P));
+				Cbnks.push_back(new Cbnk(string(to_string(files[i].Id) + ".bcbnk").c_str(), pos, cbnkLength, Resources, P));
+				Cbnks.back()->Shared = Shared;
 
-				current_path("..");
+				// A bank the CSAR holds itself has already added its presets to the shared SF2
+				if (Resources->Files[files[i].Id].Offset == nullptr)
+				{
+					Cbnks.back()->Number = Resources->FindFileCbnk(files[i].Id);
+				}
+				else
+				{
+					Cbnks.back()->AlreadyShared = Shared != nullptr;
+				}
 
 				break;
 			}
@@ -204,15 +235,16 @@ bool Cgrp::Extract()
 			{
 				pos += 8;
 
-				uint32_t cseqLength = ReadFixLen(pos, 4);
+				uint32_t cseqLength = Read<uint32_t>(pos);
 
 				pos -= 16;
 
-				ofstream ofs(string(to_string(files[i].Id) + ".bcseq"), ofstream::binary);
-				ofs.write(reinterpret_cast<const char*>(pos), cseqLength);
-				ofs.close();
+				if (Common::DumpFiles)
+				{
+					Common::Write(outPath / (to_string(files[i].Id) + ".bcseq"), pos, cseqLength);
+				}
 
-				Cseqs.push_back(new Cseq(string(to_string(files[i].Id) + ".bcseq").c_str()));
+				Cseqs.push_back(new Cseq(string(to_string(files[i].Id) + ".bcseq").c_str(), pos, cseqLength));
 
 				break;
 			}
@@ -235,19 +267,15 @@ bool Cgrp::Extract()
 
 	for (uint32_t i = 0; i < Cbnks.size(); ++i)
 	{
-		current_path(Cbnks[i]->FileName.substr(0, Cbnks[i]->FileName.length() - 6));
-
-		if (!Cbnks[i]->Convert(".."))
+		if (!Cbnks[i]->Convert(outPath / Cbnks[i]->FileName.substr(0, Cbnks[i]->FileName.length() - 6)))
 		{
 			return false;
 		}
-
-		current_path("..");
 	}
 
 	for (uint32_t i = 0; i < Cseqs.size(); ++i)
 	{
-		if (!Cseqs[i]->Convert())
+		if (!Cseqs[i]->Convert(outPath))
 		{
 			return false;
 		}
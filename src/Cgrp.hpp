@@ -3,10 +3,14 @@
 #include "Cbnk.hpp"
 #include "Cseq.hpp"
 #include "Cwar.hpp"
+#include "Index.hpp"
+#include "Library.hpp"
+#include "Mmap.hpp"
+#include "Pool.hpp"
 
 #include <cstdint>
+#include <filesystem>
 #include <ios>
-#include <map>
 #include <string>
 #include <vector>
 
@@ -22,14 +26,19 @@ struct Cgrp
 	std::string FileName;
 	std::streamoff Length;
 	uint8_t* Data = nullptr;
+	Mmap* File = nullptr;
 
-	std::map<int, Cwar*>* Cwars;
+	Index* Resources;
+	std::vector<Cwar*> Cwars;
 	std::vector<Cbnk*> Cbnks;
 	std::vector<Cseq*> Cseqs;
-	std::map<int, bool> CseqsFromCsar;
 	bool P;
+	Pool* Workers;
 
-	Cgrp(const char* fileName, std::map<int, Cwar*>* cwars, const std::map<int, bool>& cseqsFromCsar, bool p);
+	Library* Shared = nullptr;
+
+	Cgrp(const char* fileName, Index* resources, bool p, Pool* workers);
+	Cgrp(const char* fileName, uint8_t* data, std::streamoff length, Index* resources, bool p, Pool* workers);
 	~Cgrp();
-	bool Extract();
+	bool Extract(std::filesystem::path outPath);
 };
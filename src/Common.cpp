@@ -1,44 +1,43 @@
 #include "Common.hpp"
+#include "Sink.hpp"
 
+#include <cstddef>
 #include <cstdint>
-#include <fstream>
+#include <filesystem>
+#include <functional>
 #include <iostream>
+#include <sstream>
+#include <mutex>
+#include <ostream>
 #include <stack>
 #include <string>
 #include <vector>
 
 using namespace std;
+using namespace filesystem;
 
 bool Common::ShowWarnings = false;
-stack<string> Common::FileNames;
-stack<uint8_t*> Common::Offsets;
-vector<string> Common::Log;
-
-int32_t ReadFixLen(uint8_t*& pos, size_t bytes, bool littleEndian, bool isSigned)
-{
-	int32_t result = 0;
-
-	for (size_t i = 0; i < bytes; ++i)
-	{
-		result |= *pos++ << ((littleEndian ? i : bytes - i - 1) * 8);
-	}
-
-	if (isSigned && (result >= (1 << ((bytes * 8) - 1))))
-	{
-		result -= 1 << (bytes * 8);
-	}
-
-	return result;
-}
+bool Common::DumpFiles = false;
+bool Common::OnDemand = false;
+bool Common::SingleSoundFont = false;
+bool Common::Incremental = false;
+FileSink Files;
+Sink* Common::Output = &Files;
+ostream* Common::Progress = &cout;
+Cache* Common::Decoded = nullptr;
+mutex Common::Console;
+thread_local Context Common::Current;
 
 int32_t ReadVarLen(uint8_t*& pos)
 {
 	int32_t result = 0;
+	uint8_t byte;
 
 	do
 	{
-		result = (result << 7) | (*pos & 0x7F);
-	} while (*pos++ & 0x80);
+		byte = Read<uint8_t>(pos);
+		result = (result << 7) | (byte & 0x7F);
+	} while (byte & 0x80);
 
 	return result;
 }
@@ -47,42 +46,136 @@ void Common::Warning(uint8_t* pos, string msg)
 {
 	if (ShowWarnings)
 	{
+		lock_guard<mutex> lock(Console);
+
 		cerr << hex << setfill('0') << uppercase << endl;
-		cerr << "WARNING IN\t" << Common::FileNames.top() << endl;
-		cerr << "AT POSITION\t0x" << setw(8) << pos - Common::Offsets.top() << endl;
+		cerr << "WARNING IN\t" << Current.FileNames.top() << endl;
+		cerr << "AT POSITION\t0x" << setw(8) << pos - Current.Offsets.top() << endl;
 		cerr << "MESSAGE\t\t" << msg << endl;
 		cerr << endl;
 	}
 }
 
-void Common::Push(string fileName, uint8_t* data)
+void Common::Push(string fileName, uint8_t* data, streamoff length)
 {
-	FileNames.push(fileName);
-	Offsets.push(data);
+	uint8_t* end = data + length;
+
+	// A length taken from a damaged header must not reach past the file it is embedded in
+	if (!Current.Ends.empty() && (end > Current.Ends.top()))
+	{
+		end = Current.Ends.top();
+	}
 
-	cout << FileNames.top() << endl;
+	Current.FileNames.push(fileName);
+	Current.Offsets.push(data);
+	Current.Ends.push(end);
+	Current.Overrun = false;
+
+	lock_guard<mutex> lock(Console);
+
+	*Progress << Current.FileNames.top() << endl;
 }
 
 void Common::Pop()
 {
-	Offsets.pop();
-	FileNames.pop();
+	Current.Ends.pop();
+	Current.Offsets.pop();
+	Current.FileNames.pop();
 }
 
 void Common::Analyse(string tag, uint32_t val)
 {
-	Common::Log.push_back(FileNames.top() + "," + tag + "," + to_string(val));
+	if (Current.Diag == nullptr)
+	{
+		return;
+	}
+
+	lock_guard<mutex> lock(Current.Diag->Mutex);
+
+	Current.Diag->Log.push_back(Current.FileNames.top() + "," + tag + "," + to_string(val));
+}
+
+void Common::Dump(path fileName)
+{
+	if (Current.Diag == nullptr)
+	{
+		return;
+	}
+
+	ostringstream oss;
+
+	{
+		lock_guard<mutex> lock(Current.Diag->Mutex);
+
+		oss << "fileName,tag,val" << endl;
+
+		for (size_t i = 0; i < Current.Diag->Log.size(); ++i)
+		{
+			oss << Current.Diag->Log[i] << endl;
+		}
+	}
+
+	string log = oss.str();
+
+	Write(fileName, vector<uint8_t>(log.begin(), log.end()));
+}
+
+void Common::Write(path fileName, uint8_t* data, size_t length)
+{
+	Write(fileName, vector<uint8_t>(data, data + length));
+}
+
+void Common::Write(path fileName, vector<uint8_t> data)
+{
+	Produce(fileName);
+
+	Output->Write(fileName, move(data));
+}
+
+void Common::Write(path fileName, uint64_t length, const function<void(ostream&)>& write)
+{
+	Produce(fileName);
+
+	Output->Stream(fileName, length, write);
 }
 
-void Common::Dump(string fileName)
+void Common::Directory(path dirName)
 {
-	ofstream ofs(fileName);
-	ofs << "fileName,tag,val" << endl;
+	Output->Directory(dirName);
+}
 
-	for (size_t i = 0; i < Common::Log.size(); ++i)
+void Common::Produce(path fileName)
+{
+	if (Current.Produced == nullptr)
+	{
+		return;
+	}
+
+	lock_guard<mutex> lock(Current.Produced->Mutex);
+
+	Current.Produced->Files.push_back(fileName.string());
+}
+
+ptrdiff_t Common::Remaining(uint8_t* pos)
+{
+	// Outside of any pushed file there is nothing known to be left
+	if (Current.Ends.empty())
 	{
-		ofs << Common::Log[i] << endl;
+		return 0;
 	}
 
-	ofs.close();
+	return Current.Ends.top() - pos;
+}
+
+void Common::Overrun(uint8_t* pos, size_t bytes)
+{
+	// Only the first read past the end is reported, the rest just read as zero
+	if (Current.Overrun || Current.FileNames.empty())
+	{
+		return;
+	}
+
+	Current.Overrun = true;
+
+	Error(pos, to_string(bytes) + " more bytes", Remaining(pos));
 }
@@ -1,33 +1,72 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <functional>
 #include <iomanip>
 #include <ios>
 #include <iostream>
+#include <mutex>
+#include <ostream>
 #include <stack>
 #include <string>
+#include <type_traits>
 #include <vector>
 
-int32_t ReadFixLen(uint8_t*& pos, size_t bytes, bool littleEndian = true, bool isSigned = false);
-int32_t ReadVarLen(uint8_t*& pos);
+struct Cache;
+struct Sink;
+
+struct Diagnostics
+{
+	std::mutex Mutex;
+	std::vector<std::string> Log;
+};
+
+struct Outputs
+{
+	std::mutex Mutex;
+	std::vector<std::string> Files;
+};
+
+struct Context
+{
+	std::stack<std::string> FileNames;
+	std::stack<uint8_t*> Offsets;
+	std::stack<uint8_t*> Ends;
+	bool Overrun = false;
+	Diagnostics* Diag = nullptr;
+	Outputs* Produced = nullptr;
+};
 
 struct Common
 {
 	static bool ShowWarnings;
-	static std::stack<std::string> FileNames;
-	static std::stack<uint8_t*> Offsets;
-	static std::vector<std::string> Log;
+	static bool DumpFiles;
+	static bool OnDemand;
+	static bool SingleSoundFont;
+	static bool Incremental;
+	static Sink* Output;
+	static std::ostream* Progress;
+	static Cache* Decoded;
+	static std::mutex Console;
+	static thread_local Context Current;
 
-	template<typename T>
-	static bool Assert(uint8_t* pos, T expected, T found)
+	template<typename T, typename U>
+	static bool Assert(uint8_t* pos, T expected, U found)
 	{
-		if (found != expected)
+		using V = typename std::common_type<T, U>::type;
+
+		if (static_cast<V>(found) != static_cast<V>(expected))
 		{
+			std::lock_guard<std::mutex> lock(Console);
+
 			std::cerr << std::hex << std::setfill('0') << std::uppercase << std::endl;
-			std::cerr << "ERROR IN\t" << Common::FileNames.top() << std::endl;
-			std::cerr << "AT POSITION\t0x" << std::setw(8) << pos - Common::Offsets.top() << std::endl;
-			std::cerr << "EXPECTED\t0x" << std::setw(8) << expected << std::endl;
-			std::cerr << "INSTEAD GOT\t0x" << std::setw(8) << found << std::endl;
+			std::cerr << "ERROR IN\t" << Current.FileNames.top() << std::endl;
+			std::cerr << "AT POSITION\t0x" << std::setw(8) << pos - Current.Offsets.top() << std::endl;
+			std::cerr << "EXPECTED\t0x" << std::setw(8) << +expected << std::endl;
+			std::cerr << "INSTEAD GOT\t0x" << std::setw(8) << +found << std::endl;
 			std::cerr << std::endl;
 
 			return false;
@@ -39,17 +78,95 @@ struct Common
 	template<typename T>
 	static void Error(uint8_t* pos, std::string expected, T found)
 	{
+		std::lock_guard<std::mutex> lock(Console);
+
 		std::cerr << std::hex << std::setfill('0') << std::uppercase << std::endl;
-		std::cerr << "ERROR IN\t" << Common::FileNames.top() << std::endl;
-		std::cerr << "AT POSITION\t0x" << std::setw(8) << pos - Common::Offsets.top() << std::endl;
+		std::cerr << "ERROR IN\t" << Current.FileNames.top() << std::endl;
+		std::cerr << "AT POSITION\t0x" << std::setw(8) << pos - Current.Offsets.top() << std::endl;
 		std::cerr << "EXPECTED\t" << expected << std::endl;
-		std::cerr << "INSTEAD GOT\t0x" << std::setw(8) << found << std::endl;
+		std::cerr << "INSTEAD GOT\t0x" << std::setw(8) << +found << std::endl;
 		std::cerr << std::endl;
 	}
 
 	static void Warning(uint8_t* pos, std::string msg);
-	static void Push(std::string fileName, uint8_t* data);
+	static void Push(std::string fileName, uint8_t* data, std::streamoff length);
 	static void Pop();
 	static void Analyse(std::string tag, uint32_t val);
-	static void Dump(std::string fileName);
+	static void Dump(std::filesystem::path fileName);
+	static void Write(std::filesystem::path fileName, uint8_t* data, size_t length);
+	static void Write(std::filesystem::path fileName, std::vector<uint8_t> data);
+	static void Write(std::filesystem::path fileName, uint64_t length, const std::function<void(std::ostream&)>& write);
+	static void Directory(std::filesystem::path dirName);
+	static void Produce(std::filesystem::path fileName);
+	static std::ptrdiff_t Remaining(uint8_t* pos);
+	static void Overrun(uint8_t* pos, size_t bytes);
+};
+
+enum class Endian
+{
+	Little,
+	Big
 };
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+constexpr Endian HostEndian = Endian::Big;
+#else
+constexpr Endian HostEndian = Endian::Little;
+#endif
+
+// Reads a field of a fixed width, stopping at the end of the file that is currently being parsed
+template<typename T, Endian E = Endian::Little, size_t Bytes = sizeof(T)>
+T Read(uint8_t*& pos)
+{
+	static_assert(std::is_integral<T>::value && (Bytes <= sizeof(T)), "Fields are integers no wider than their type");
+
+	using U = typename std::make_unsigned<T>::type;
+
+	if (Common::Remaining(pos) < static_cast<std::ptrdiff_t>(Bytes))
+	{
+		Common::Overrun(pos, Bytes);
+
+		return 0;
+	}
+
+	U value = 0;
+
+	if constexpr (Bytes == sizeof(T))
+	{
+		std::memcpy(&value, pos, Bytes);
+
+		if constexpr ((E != HostEndian) && (Bytes > 1))
+		{
+			U swapped = 0;
+
+			for (size_t i = 0; i < Bytes; ++i)
+			{
+				swapped = static_cast<U>((swapped << 8) | ((value >> (i * 8)) & 0xFF));
+			}
+
+			value = swapped;
+		}
+	}
+	else
+	{
+		for (size_t i = 0; i < Bytes; ++i)
+		{
+			value = static_cast<U>(value | (static_cast<U>(pos[i]) << ((E == Endian::Little ? i : Bytes - i - 1) * 8)));
+		}
+
+		if constexpr (std::is_signed<T>::value)
+		{
+			constexpr size_t shift = (sizeof(T) - Bytes) * 8;
+
+			pos += Bytes;
+
+			return static_cast<T>(static_cast<T>(value << shift) >> shift);
+		}
+	}
+
+	pos += Bytes;
+
+	return static_cast<T>(value);
+}
+
+int32_t ReadVarLen(uint8_t*& pos);
@@ -4,77 +4,93 @@
 #include "Common.hpp"
 #include "Cseq.hpp"
 #include "Cwar.hpp"
-
+#include "Hash.hpp"
+#include "Index.hpp"
+#include "Library.hpp"
+#include "Manifest.hpp"
+#include "Mmap.hpp"
+#include "Pool.hpp"
+#include "Sink.hpp"
+
+#include <cstddef>
 #include <cstdint>
 #include <filesystem>
-#include <fstream>
-#include <map>
 #include <string>
 #include <vector>
 
 using namespace std;
 using namespace filesystem;
 
-Csar::Csar(const char* fileName, bool p) : FileName(fileName), P(p)
+Csar::Csar(const char* fileName, bool p, Pool* workers) : FileName(fileName), P(p), Workers(workers)
 {
-	ifstream ifs(FileName, ios::binary | ios::ate);
-
-	Length = ifs.tellg();
-	Data = new uint8_t[Length];
+	File = new Mmap(FileName.c_str());
 
-	Common::Push(FileName, Data);
+	Length = File->Length;
+	Data = File->Data;
 
-	ifs.seekg(0, ios::beg);
-	ifs.read(reinterpret_cast<char*>(Data), Length);
-	ifs.close();
+	Common::Current.Diag = &Diag;
+	Common::Push(FileName, Data, Length);
 }
 
 Csar::~Csar()
 {
-	for (auto& cwar : Cwars)
-	{
-		delete cwar.second;
-	}
-
 	Common::Pop();
+	Common::Current.Diag = nullptr;
 
-	delete[] Data;
+	delete Shared;
+	delete File;
 }
 
-bool Csar::Extract()
+bool Csar::Extract(path outPath)
 {
-	create_directory(FileName.substr(0, FileName.length() - 6));
-	current_path(FileName.substr(0, FileName.length() - 6));
+	if (Data == nullptr)
+	{
+		Common::Error(Data, "A readable file", Length);
+
+		return false;
+	}
+
+	Common::Directory(outPath);
+
+	if (Common::SingleSoundFont)
+	{
+		delete Shared;
+
+		Shared = new Library(path(FileName).filename().replace_extension().string());
+	}
+
+	// Each sub-file is recorded with the bytes it came from and the files it produced, so that the next run can leave it alone if neither has changed
+	Manifest manifest(outPath / path(FileName).filename().replace_extension("manifest"), outPath, string("p=") + (P ? "1" : "0") + "\td=" + (Common::DumpFiles ? "1" : "0") + "\tr=" + (Common::OnDemand ? "1" : "0") + "\ts=" + (Common::SingleSoundFont ? "1" : "0"), Common::Incremental && Common::Output->Files());
 
 	uint8_t* pos = Data;
 
-	if (!Common::Assert(pos, 0x43534152, ReadFixLen(pos, 4, false))) { return false; }
-	if (!Common::Assert(pos, 0xFEFF, ReadFixLen(pos, 2))) { return false; }
-	if (!Common::Assert(pos, 0x40, ReadFixLen(pos, 2))) { return false; }
+	if (!Common::Assert(pos, 0x43534152, Read<uint32_t, Endian::Big>(pos))) { return false; }
+	if (!Common::Assert(pos, 0xFEFF, Read<uint16_t>(pos))) { return false; }
+	if (!Common::Assert(pos, 0x40, Read<uint16_t>(pos))) { return false; }
 
-	uint32_t csarVersion = ReadFixLen(pos, 4);
-	uint32_t length = ReadFixLen(pos, 4);
+	uint32_t csarVersion = Read<uint32_t>(pos);
+	uint32_t length = Read<uint32_t>(pos);
 
 	if (csarVersion != 0x02000000)
 	{
 		if (!Common::Assert<uint64_t>(pos, Length, length)) { return false; }
 	}
 
-	if (!Common::Assert(pos, 0x3, ReadFixLen(pos, 4))) { return false; }
-	if (!Common::Assert(pos, 0x2000, ReadFixLen(pos, 4))) { return false; }
+	if (!Common::Assert(pos, 0x3, Read<uint32_t>(pos))) { return false; }
+	if (!Common::Assert(pos, 0x2000, Read<uint32_t>(pos))) { return false; }
 
-	uint32_t strgOffset = ReadFixLen(pos, 4);
-	uint32_t strgLength = ReadFixLen(pos, 4);
+	uint32_t strgOffset = Read<uint32_t>(pos);
+	uint32_t strgLength = Read<uint32_t>(pos);
 
-	if (!Common::Assert(pos, 0x2001, ReadFixLen(pos, 4))) { return false; }
+	if (!Common::Assert(pos, 0x2001, Read<uint32_t>(pos))) { return false; }
 
-	uint32_t infoOffset = ReadFixLen(pos, 4);
-	uint32_t infoLength = ReadFixLen(pos, 4);
+	uint32_t infoOffset = Read<uint32_t>(pos);
+	uint32_t infoLength = Read<uint32_t>(pos);
 
-	if (!Common::Assert(pos, 0x2002, ReadFixLen(pos, 4))) { return false; }
+	if (!Common::Assert(pos, 0x2002, Read<uint32_t>(pos))) { return false; }
 
-	uint32_t fileOffset = ReadFixLen(pos, 4);
-	uint32_t fileLength = ReadFixLen(pos, 4);
+	uint32_t fileOffset = Read<uint32_t>(pos);
+	uint32_t fileLength = Read<uint32_t>(pos);
 
 	vector<CsarStrg> strgs;
 
@@ -82,30 +98,37 @@ bool Csar::Extract()
 	{
 		pos = Data + strgOffset;
 
-		if (!Common::Assert(pos, 0x53545247, ReadFixLen(pos, 4, false))) { return false; }
-		if (!Common::Assert<uint32_t>(pos, strgLength, ReadFixLen(pos, 4))) { return false; }
-		if (!Common::Assert(pos, 0x2400, ReadFixLen(pos, 4))) { return false; }
+		if (!Common::Assert(pos, 0x53545247, Read<uint32_t, Endian::Big>(pos))) { return false; }
+		if (!Common::Assert<uint32_t>(pos, strgLength, Read<uint32_t>(pos))) { return false; }
+		if (!Common::Assert(pos, 0x2400, Read<uint32_t>(pos))) { return false; }
 
-		uint32_t strgStringsOffset = ReadFixLen(pos, 4);
+		uint32_t strgStringsOffset = Read<uint32_t>(pos);
 
-		if (!Common::Assert(pos, 0x2401, ReadFixLen(pos, 4))) { return false; }
+		if (!Common::Assert(pos, 0x2401, Read<uint32_t>(pos))) { return false; }
 
-		uint32_t strgUnknownOffset = ReadFixLen(pos, 4);
-		uint32_t strgCount = ReadFixLen(pos, 4);
+		uint32_t strgUnknownOffset = Read<uint32_t>(pos);
+		uint32_t strgCount = Read<uint32_t>(pos);
 
 		for (uint32_t i = 0; i < strgCount; ++i)
 		{
-			if (!Common::Assert(pos, 0x1F01, ReadFixLen(pos, 4))) { return false; }
+			if (!Common::Assert(pos, 0x1F01, Read<uint32_t>(pos))) { return false; }
 
 			CsarStrg strg;
-			strg.Offset = Data + strgOffset + 24 + ReadFixLen(pos, 4);
-			strg.Length = ReadFixLen(pos, 4);
+			strg.Offset = Data + strgOffset + 24 + Read<uint32_t>(pos);
+			strg.Length = Read<uint32_t>(pos);
 
 			strgs.push_back(strg);
 		}
 
 		for (uint32_t i = 0; i < strgCount; ++i)
 		{
+			if ((strgs[i].Length == 0) || (Common::Remaining(pos) < static_cast<ptrdiff_t>(strgs[i].Length)))
+			{
+				Common::Error(pos, "A string within the file", strgs[i].Length);
+
+				return false;
+			}
+
 			strgs[i].String = string(reinterpret_cast<const char*>(pos), strgs[i].Length - 1);
 
 			pos = i != (strgCount - 1) ? strgs[i + 1].Offset : pos + strgs[i].Length;
@@ -114,8 +137,8 @@ bool Csar::Extract()
 
 	pos = Data + infoOffset;
 
-	if (!Common::Assert(pos, 0x494E464F, ReadFixLen(pos, 4, false))) { return false; }
-	if (!Common::Assert<uint32_t>(pos, infoLength, ReadFixLen(pos, 4))) { return false; }
+	if (!Common::Assert(pos, 0x494E464F, Read<uint32_t, Endian::Big>(pos))) { return false; }
+	if (!Common::Assert<uint32_t>(pos, infoLength, Read<uint32_t>(pos))) { return false; }
 
 	uint32_t infoCseqOffset = 0;
 	uint32_t infoCbnkOffset = 0;
@@ -128,33 +151,33 @@ bool Csar::Extract()
 
 	for (uint8_t i = 0; i < 8; ++i)
 	{
-		uint32_t offsetId = ReadFixLen(pos, 4);
+		uint32_t offsetId = Read<uint32_t>(pos);
 
 		switch (offsetId)
 		{
 			case 0x2100:
-				infoCseqOffset = ReadFixLen(pos, 4); break;
+				infoCseqOffset = Read<uint32_t>(pos); break;
 
 			case 0x2101:
-				infoCbnkOffset = ReadFixLen(pos, 4); break;
+				infoCbnkOffset = Read<uint32_t>(pos); break;
 
 			case 0x2102:
-				infoPlayerOffset = ReadFixLen(pos, 4); break;
+				infoPlayerOffset = Read<uint32_t>(pos); break;
 
 			case 0x2103:
-				infoCwarOffset = ReadFixLen(pos, 4); break;
+				infoCwarOffset = Read<uint32_t>(pos); break;
 
 			case 0x2104:
-				infoSetOffset = ReadFixLen(pos, 4); break;
+				infoSetOffset = Read<uint32_t>(pos); break;
 
 			case 0x2105:
-				infoCgrpOffset = ReadFixLen(pos, 4); break;
+				infoCgrpOffset = Read<uint32_t>(pos); break;
 
 			case 0x2106:
-				infoFileOffset = ReadFixLen(pos, 4); break;
+				infoFileOffset = Read<uint32_t>(pos); break;
 
 			case 0x220B:
-				infoEndOffset = ReadFixLen(pos, 4); break;
+				infoEndOffset = Read<uint32_t>(pos); break;
 
 			default:
 				Common::Error(pos - 4, "A valid chunk type", offsetId);
@@ -165,35 +188,35 @@ bool Csar::Extract()
 
 	pos = Data + infoOffset + 8 + infoFileOffset;
 
-	uint32_t fileCount = ReadFixLen(pos, 4);
+	uint32_t fileCount = Read<uint32_t>(pos);
 
 	vector<uint8_t*> fileOffsets;
 
 	for (uint32_t i = 0; i < fileCount; ++i)
 	{
-		if (!Common::Assert(pos, 0x220A, ReadFixLen(pos, 4))) { return false; }
+		if (!Common::Assert(pos, 0x220A, Read<uint32_t>(pos))) { return false; }
 
-		fileOffsets.push_back(Data + infoOffset + 8 + infoFileOffset + ReadFixLen(pos, 4));
+		fileOffsets.push_back(Data + infoOffset + 8 + infoFileOffset + Read<uint32_t>(pos));
 	}
 
-	vector<CsarFile> files;
+	vector<CsarFile>& files = Resources.Files;
 
 	for (uint32_t i = 0; i < fileCount; ++i)
 	{
 		pos = fileOffsets[i];
 
 		CsarFile file;
-		uint32_t fileId = ReadFixLen(pos, 4);
+		uint32_t fileId = Read<uint32_t>(pos);
 
 		switch (fileId)
 		{
 			case 0x220C:
 			{
-				if (!Common::Assert(pos, 0xC, ReadFixLen(pos, 8))) { return false; }
-				Common::Analyse("0x220C 0x08", ReadFixLen(pos, 4));
+				if (!Common::Assert(pos, 0xC, Read<uint64_t>(pos))) { return false; }
+				Common::Analyse("0x220C 0x08", Read<uint32_t>(pos));
 
-				file.Offset = Data + fileOffset + 8 + ReadFixLen(pos, 4);
-				file.Length = ReadFixLen(pos, 4);
+				file.Offset = Data + fileOffset + 8 + Read<uint32_t>(pos);
+				file.Length = Read<uint32_t>(pos);
 
 				if ((file.Offset >= (Data + Length)) || (file.Length == 0xFFFFFFFF))
 				{
@@ -206,9 +229,9 @@ bool Csar::Extract()
 
 			case 0x220D:
 			{
-				if (!Common::Assert(pos, 0xC, ReadFixLen(pos, 8))) { return false; }
+				if (!Common::Assert(pos, 0xC, Read<uint64_t>(pos))) { return false; }
 
-				while (*pos != 0x00)
+				while ((Common::Remaining(pos) > 0) && (*pos != 0x00))
 				{
 					file.Location += *pos++;
 				}
@@ -231,73 +254,112 @@ bool Csar::Extract()
 		files.push_back(file);
 	}
 
+	Resources.FileCwars.assign(fileCount, Index::None);
+	Resources.FileCbnks.assign(fileCount, Index::None);
+	Resources.FileCseqs.assign(fileCount, false);
+
+	// Work is scheduled as it is found; a bank only waits on the wave archives it references
+	Tasks tasks(Workers);
+
 	pos = Data + infoOffset + 8 + infoCwarOffset;
 
-	uint32_t cwarCount = ReadFixLen(pos, 4);
+	uint32_t cwarCount = Read<uint32_t>(pos);
+
+	// Banks refer to wave archives by their index here
+	Resources.Cwars.assign(cwarCount, nullptr);
+
+	vector<Job*> cwarJobs(cwarCount, nullptr);
+	vector<uint64_t> cwarHashes(cwarCount, 0);
 
 	vector<uint8_t*> cwarOffsets;
 
 	for (uint32_t i = 0; i < cwarCount; ++i)
 	{
-		if (!Common::Assert(pos, 0x2207, ReadFixLen(pos, 4))) { return false; }
+		if (!Common::Assert(pos, 0x2207, Read<uint32_t>(pos))) { return false; }
 
-		cwarOffsets.push_back(Data + infoOffset + 8 + infoCwarOffset + ReadFixLen(pos, 4));
+		cwarOffsets.push_back(Data + infoOffset + 8 + infoCwarOffset + Read<uint32_t>(pos));
 	}
 
 	for (uint32_t i = 0; i < cwarCount; ++i)
 	{
 		pos = cwarOffsets[i];
 
-		uint32_t id = ReadFixLen(pos, 4);
+		uint32_t id = Read<uint32_t>(pos);
+
+		if (id >= files.size())
+		{
+			Common::Error(pos - 4, "A valid file identifier", id);
+
+			return false;
+		}
+
+		Common::Analyse("Cwar 0x04", Read<uint32_t>(pos));
+
+		uint32_t hasFileName = Read<uint32_t>(pos);
+
+		string fileName = to_string(id);
 
-		Common::Analyse("Cwar 0x04", ReadFixLen(pos, 4));
+		if (hasFileName && (strgOffset != 0xFFFFFFFF))
+		{
+			uint32_t strgId = Read<uint32_t>(pos);
+
+			if (strgId >= strgs.size())
+			{
+				Common::Error(pos - 4, "A valid string identifier", strgId);
+
+				return false;
+			}
 
-		uint32_t hasFileName = ReadFixLen(pos, 4);
+			fileName = strgs[strgId].String;
+		}
 
-		string fileName = hasFileName  && (strgOffset != 0xFFFFFFFF) ? strgs[ReadFixLen(pos, 4)].String : to_string(id);
+		Resources.FileCwars[id] = i;
 
 		if (files[id].Offset != nullptr)
 		{
 			pos = files[id].Offset + 12;
 
-			uint32_t cwarLength = ReadFixLen(pos, 4);
+			uint32_t cwarLength = Read<uint32_t>(pos);
 
 			pos -= 16;
 
-			create_directory(fileName);
-			current_path(fileName);
+			Common::Directory(outPath / fileName);
 
-			ofstream ofs(string(fileName + ".bcwar"), ofstream::binary);
-			ofs.write(reinterpret_cast<const char*>(pos), cwarLength);
-			ofs.close();
+			ManifestEntry* entry = manifest.Track(fileName + "/" + fileName + ".bcwar", Data, pos, cwarLength);
 
-			Cwars[id] = new Cwar(string(fileName + ".bcwar").c_str());
+			// An unchanged wave archive is still opened, since the banks need its samples, but its WAVs are mapped rather than decoded
+			Common::Current.Produced = !entry->Unchanged ? &entry->Produced : nullptr;
 
-			if (!Cwars[id]->Extract())
+			if (Common::DumpFiles && !entry->Unchanged)
 			{
-				return false;
+				Common::Write(outPath / fileName / (fileName + ".bcwar"), pos, cwarLength);
 			}
 
-			current_path("..");
-		}
-		else
-		{
-			Cwars[id] = nullptr;
+			Cwar* cwar = new Cwar(string(fileName + ".bcwar").c_str(), pos, cwarLength, Workers);
+			cwar->Keep = entry->Unchanged;
+
+			Resources.Cwars[i] = cwar;
+			cwarJobs[i] = tasks.Run([cwar, outPath, fileName] { return cwar->Extract(outPath / fileName); });
+			cwarHashes[i] = entry->Hash;
+
+			Common::Current.Produced = nullptr;
 		}
 	}
 
+	vector<Job*> cbnkJobs;
+
 	pos = Data + infoOffset + 8 + infoCbnkOffset;
 
-	uint32_t cbnkCount = ReadFixLen(pos, 4);
+	uint32_t cbnkCount = Read<uint32_t>(pos);
 
-	vector<CsarCbnk> cbnks;
+	vector<CsarCbnk>& cbnks = Resources.Cbnks;
 
 	for (uint32_t i = 0; i < cbnkCount; ++i)
 	{
-		if (!Common::Assert(pos, 0x2206, ReadFixLen(pos, 4))) { return false; }
+		if (!Common::Assert(pos, 0x2206, Read<uint32_t>(pos))) { return false; }
 
 		CsarCbnk cbnk;
-		cbnk.Offset = Data + infoOffset + 8 + infoCbnkOffset + ReadFixLen(pos, 4);
+		cbnk.Offset = Data + infoOffset + 8 + infoCbnkOffset + Read<uint32_t>(pos);
 
 		cbnks.push_back(cbnk);
 	}
@@ -306,53 +368,109 @@ bool Csar::Extract()
 	{
 		pos = cbnks[i].Offset;
 
-		cbnks[i].Id = ReadFixLen(pos, 4);
+		cbnks[i].Id = Read<uint32_t>(pos);
+
+		if (cbnks[i].Id >= files.size())
+		{
+			Common::Error(pos - 4, "A valid file identifier", cbnks[i].Id);
+
+			return false;
+		}
+
+		Common::Analyse("Cbnk 0x04", Read<uint32_t>(pos));
+		Common::Analyse("Cbnk 0x08", Read<uint32_t>(pos));
+		Common::Analyse("Cbnk 0x0C", Read<uint32_t>(pos));
+
+		cbnks[i].FileName = to_string(cbnks[i].Id);
+
+		if (strgOffset != 0xFFFFFFFF)
+		{
+			uint32_t strgId = Read<uint32_t>(pos);
+
+			if (strgId >= strgs.size())
+			{
+				Common::Error(pos - 4, "A valid string identifier", strgId);
+
+				return false;
+			}
 
-		Common::Analyse("Cbnk 0x04", ReadFixLen(pos, 4));
-		Common::Analyse("Cbnk 0x08", ReadFixLen(pos, 4));
-		Common::Analyse("Cbnk 0x0C", ReadFixLen(pos, 4));
+			cbnks[i].FileName = strgs[strgId].String;
+		}
 
-		cbnks[i].FileName = strgOffset != 0xFFFFFFFF ? strgs[ReadFixLen(pos, 4)].String : to_string(cbnks[i].Id);
+		Resources.FileCbnks[cbnks[i].Id] = i;
 
-		create_directory(cbnks[i].FileName);
-		current_path(cbnks[i].FileName);
+		Common::Directory(outPath / cbnks[i].FileName);
 
 		if (files[cbnks[i].Id].Offset != nullptr)
 		{
 			pos = files[cbnks[i].Id].Offset + 12;
 
-			uint32_t cbnkLength = ReadFixLen(pos, 4);
+			uint32_t cbnkLength = Read<uint32_t>(pos);
 
 			pos -= 16;
 
-			ofstream ofs(string(cbnks[i].FileName + ".bcbnk"), ofstream::binary);
-			ofs.write(reinterpret_cast<const char*>(pos), cbnkLength);
-			ofs.close();
+			vector<Job*> dependencies;
+			vector<uint64_t> references;
+
+			for (auto cwar : Cbnk::References(pos, cbnkLength))
+			{
+				if ((cwar < cwarCount) && (cwarJobs[cwar] != nullptr))
+				{
+					dependencies.push_back(cwarJobs[cwar]);
+					references.push_back(cwarHashes[cwar]);
+				}
+			}
+
+			// A bank is only unchanged if the wave archives it takes its samples from are as well
+			ManifestEntry* entry = manifest.Track(cbnks[i].FileName + "/" + cbnks[i].FileName + ".bcbnk", Data, pos, cbnkLength, Hash64(reinterpret_cast<uint8_t*>(references.data()), references.size() * sizeof(uint64_t)));
 
-			Cbnk cbnk(string(cbnks[i].FileName + ".bcbnk").c_str(), &Cwars, P);
+			// The shared SF2 is rebuilt from every bank on each run
+			if (entry->Unchanged && (Shared != nullptr))
+			{
+				entry->Unchanged = false;
+				entry->Produced.Files.clear();
+			}
 
-			if (!cbnk.Convert(".."))
+			if (entry->Unchanged)
 			{
-				return false;
+				continue;
 			}
-		}
 
-		current_path("..");
+			Common::Current.Produced = &entry->Produced;
+
+			if (Common::DumpFiles)
+			{
+				Common::Write(outPath / cbnks[i].FileName / (cbnks[i].FileName + ".bcbnk"), pos, cbnkLength);
+			}
+
+			string fileName = cbnks[i].FileName;
+
+			cbnkJobs.push_back(tasks.Run([this, pos, cbnkLength, outPath, fileName, i]
+			{
+				Cbnk cbnk(string(fileName + ".bcbnk").c_str(), pos, cbnkLength, &Resources, P);
+				cbnk.Shared = Shared;
+				cbnk.Number = i;
+
+				return cbnk.Convert(outPath / fileName);
+			}, dependencies));
+
+			Common::Current.Produced = nullptr;
+		}
 	}
 
 	pos = Data + infoOffset + 8 + infoCseqOffset;
 
-	uint32_t cseqCount = ReadFixLen(pos, 4);
+	uint32_t cseqCount = Read<uint32_t>(pos);
 
-	vector<CsarCseq> cseqs;
-	map<int, bool> cseqsFromCsar;
+	vector<CsarCseq>& cseqs = Resources.Cseqs;
+	vector<uint64_t> cseqHashes;
 
 	for (uint32_t i = 0; i < cseqCount; ++i)
 	{
-		if (!Common::Assert(pos, 0x2200, ReadFixLen(pos, 4))) { return false; }
+		if (!Common::Assert(pos, 0x2200, Read<uint32_t>(pos))) { return false; }
 
 		CsarCseq cseq;
-		cseq.Offset = Data + infoOffset + 8 + infoCseqOffset + ReadFixLen(pos, 4);
+		cseq.Offset = Data + infoOffset + 8 + infoCseqOffset + Read<uint32_t>(pos);
 
 		cseqs.push_back(cseq);
 	}
@@ -361,17 +479,38 @@ bool Csar::Extract()
 	{
 		pos = cseqs[i].Offset;
 
-		uint32_t id = ReadFixLen(pos, 4);
+		uint32_t id = Read<uint32_t>(pos);
+
+		if (id >= files.size())
+		{
+			Common::Error(pos - 4, "A valid file identifier", id);
+
+			return false;
+		}
+
+		Common::Analyse("Cseq 0x04", Read<uint32_t>(pos));
+		Common::Analyse("Cseq 0x08", Read<uint32_t>(pos));
+
+		uint32_t type = Read<uint32_t>(pos);
+		uint32_t cbnkOffset = Read<uint32_t>(pos);
+
+		Common::Analyse("Cseq 0x14", Read<uint32_t>(pos));
 
-		Common::Analyse("Cseq 0x04", ReadFixLen(pos, 4));
-		Common::Analyse("Cseq 0x08", ReadFixLen(pos, 4));
+		cseqs[i].FileName = to_string(id);
+
+		if (strgOffset != 0xFFFFFFFF)
+		{
+			uint32_t strgId = Read<uint32_t>(pos);
 
-		uint32_t type = ReadFixLen(pos, 4);
-		uint32_t cbnkOffset = ReadFixLen(pos, 4);
+			if (strgId >= strgs.size())
+			{
+				Common::Error(pos - 4, "A valid string identifier", strgId);
 
-		Common::Analyse("Cseq 0x14", ReadFixLen(pos, 4));
+				return false;
+			}
 
-		cseqs[i].FileName = strgOffset != 0xFFFFFFFF ? strgs[ReadFixLen(pos, 4)].String : to_string(id);
+			cseqs[i].FileName = strgs[strgId].String;
+		}
 
 		switch (type)
 		{
@@ -395,30 +534,49 @@ bool Csar::Extract()
 				{
 					pos += cbnkOffset;
 
-					uint32_t cbnk = ReadFixLen(pos, 2);
+					uint32_t cbnk = Read<uint16_t>(pos);
+
+					if (cbnk >= cbnks.size())
+					{
+						Common::Error(pos - 2, "A valid bank index", cbnk);
+
+						return false;
+					}
 
 					pos = files[id].Offset + 12;
 
-					uint32_t cseqLength = ReadFixLen(pos, 4);
+					uint32_t cseqLength = Read<uint32_t>(pos);
 
 					pos -= 16;
 
-					current_path(cbnks[cbnk].FileName);
+					Resources.FileCseqs[id] = true;
+
+					ManifestEntry* entry = manifest.Track(cbnks[cbnk].FileName + "/" + cseqs[i].FileName + ".bcseq", Data, pos, cseqLength);
+					cseqHashes.push_back(entry->Hash);
 
-					ofstream ofs(string(cseqs[i].FileName + ".bcseq"), ofstream::binary);
-					ofs.write(reinterpret_cast<const char*>(pos), cseqLength);
-					ofs.close();
+					if (entry->Unchanged)
+					{
+						break;
+					}
 
-					Cseq cseq(string(cseqs[i].FileName + ".bcseq").c_str());
+					Common::Current.Produced = &entry->Produced;
 
-					if (!cseq.Convert())
+					if (Common::DumpFiles)
 					{
-						return false;
+						Common::Write(outPath / cbnks[cbnk].FileName / (cseqs[i].FileName + ".bcseq"), pos, cseqLength);
 					}
 
-					current_path("..");
+					string fileName = cseqs[i].FileName;
+					path cseqPath = outPath / cbnks[cbnk].FileName;
+
+					tasks.Run([pos, cseqLength, fileName, cseqPath]
+					{
+						Cseq cseq(string(fileName + ".bcseq").c_str(), pos, cseqLength);
+
+						return cseq.Convert(cseqPath);
+					});
 
-					cseqsFromCsar[id] = true;
+					Common::Current.Produced = nullptr;
 				}
 
 				break;
@@ -433,83 +591,180 @@ bool Csar::Extract()
 
 	pos = Data + infoOffset + 8 + infoPlayerOffset;
 
-	uint32_t playerCount = ReadFixLen(pos, 4);
+	uint32_t playerCount = Read<uint32_t>(pos);
 
 	vector<uint8_t*> playerOffsets;
 
 	for (uint32_t i = 0; i < playerCount; ++i)
 	{
-		if (!Common::Assert(pos, 0x2209, ReadFixLen(pos, 4))) { return false; }
+		if (!Common::Assert(pos, 0x2209, Read<uint32_t>(pos))) { return false; }
 
-		playerOffsets.push_back(Data + infoOffset + 8 + infoPlayerOffset + ReadFixLen(pos, 4));
+		playerOffsets.push_back(Data + infoOffset + 8 + infoPlayerOffset + Read<uint32_t>(pos));
 	}
 
 	pos = Data + infoOffset + 8 + infoSetOffset;
 
-	uint32_t setCount = ReadFixLen(pos, 4);
+	uint32_t setCount = Read<uint32_t>(pos);
 
 	vector<uint8_t*> setOffsets;
 
 	for (uint32_t i = 0; i < setCount; ++i)
 	{
-		if (!Common::Assert(pos, 0x2204, ReadFixLen(pos, 4))) { return false; }
+		if (!Common::Assert(pos, 0x2204, Read<uint32_t>(pos))) { return false; }
+
+		setOffsets.push_back(Data + infoOffset + 8 + infoSetOffset + Read<uint32_t>(pos));
+	}
 
-		setOffsets.push_back(Data + infoOffset + 8 + infoSetOffset + ReadFixLen(pos, 4));
+	// Groups fill in the wave archives the CSAR only names, which the banks above must not see half made, so they run after every bank and one at a time
+	vector<Job*> cgrpDependencies = cbnkJobs;
+
+	for (auto cwarJob : cwarJobs)
+	{
+		if (cwarJob != nullptr)
+		{
+			cgrpDependencies.push_back(cwarJob);
+		}
 	}
 
 	pos = Data + infoOffset + 8 + infoCgrpOffset;
 
-	uint32_t cgrpCount = ReadFixLen(pos, 4);
+	uint32_t cgrpCount = Read<uint32_t>(pos);
 
-	vector<CsarCgrp> cgrps;
+	vector<CsarCgrp>& cgrps = Resources.Cgrps;
 
 	for (uint32_t i = 0; i < cgrpCount; ++i)
 	{
-		if (!Common::Assert(pos, 0x2208, ReadFixLen(pos, 4))) { return false; }
+		if (!Common::Assert(pos, 0x2208, Read<uint32_t>(pos))) { return false; }
 
 		CsarCgrp cgrp;
-		cgrp.Offset = Data + infoOffset + 8 + infoCgrpOffset + ReadFixLen(pos, 4);
+		cgrp.Offset = Data + infoOffset + 8 + infoCgrpOffset + Read<uint32_t>(pos);
 
 		cgrps.push_back(cgrp);
 	}
 
+	// Groups see the wave archives and sequences of the archive and of every group before them, so they are either all left alone or all extracted again
+	vector<uint64_t> cgrpInputs;
+
+	for (uint32_t i = 0; i < cwarCount; ++i)
+	{
+		if (cwarJobs[i] != nullptr)
+		{
+			cgrpInputs.push_back(cwarHashes[i]);
+		}
+	}
+
+	cgrpInputs.insert(cgrpInputs.end(), cseqHashes.begin(), cseqHashes.end());
+
+	uint64_t cgrpSeed = Hash64(reinterpret_cast<uint8_t*>(cgrpInputs.data()), cgrpInputs.size() * sizeof(uint64_t));
+	bool cgrpsUnchanged = Shared == nullptr;
+
+	vector<ManifestEntry*> cgrpEntries(cgrpCount, nullptr);
+	vector<uint8_t*> cgrpData(cgrpCount, nullptr);
+	vector<uint32_t> cgrpLengths(cgrpCount, 0);
+
 	for (uint32_t i = 0; i < cgrpCount; ++i)
 	{
 		pos = cgrps[i].Offset;
 
-		cgrps[i].Id = ReadFixLen(pos, 4);
+		cgrps[i].Id = Read<uint32_t>(pos);
 
 		if (cgrps[i].Id == 0xFFFFFFFF)
 		{
 			continue;
 		}
 
-		if (!Common::Assert(pos, 0x1, ReadFixLen(pos, 4))) { return false; }
+		if (cgrps[i].Id >= files.size())
+		{
+			Common::Error(pos - 4, "A valid file identifier", cgrps[i].Id);
+
+			return false;
+		}
+
+		if (!Common::Assert(pos, 0x1, Read<uint32_t>(pos))) { return false; }
+
+		cgrps[i].FileName = to_string(cgrps[i].Id);
+
+		if (strgOffset != 0xFFFFFFFF)
+		{
+			uint32_t strgId = Read<uint32_t>(pos);
+
+			if (strgId >= strgs.size())
+			{
+				Common::Error(pos - 4, "A valid string identifier", strgId);
 
-		cgrps[i].FileName = strgOffset != 0xFFFFFFFF ? strgs[ReadFixLen(pos, 4)].String : to_string(cgrps[i].Id);
+				return false;
+			}
+
+			cgrps[i].FileName = strgs[strgId].String;
+		}
 
 		if (files[cgrps[i].Id].Offset != nullptr)
 		{
 			pos = files[cgrps[i].Id].Offset + 12;
 
-			uint32_t cgrpLength = ReadFixLen(pos, 4);
+			uint32_t cgrpLength = Read<uint32_t>(pos);
 
 			pos -= 16;
 
-			ofstream ofs(string(cgrps[i].FileName + ".bcgrp"), ofstream::binary);
-			ofs.write(reinterpret_cast<const char*>(pos), cgrpLength);
-			ofs.close();
+			cgrpEntries[i] = manifest.Track(cgrps[i].FileName + ".bcgrp", Data, pos, cgrpLength, cgrpSeed);
+			cgrpData[i] = pos;
+			cgrpLengths[i] = cgrpLength;
 
-			Cgrp cgrp(string(cgrps[i].FileName + ".bcgrp").c_str(), &Cwars, cseqsFromCsar, P);
+			cgrpsUnchanged = cgrpsUnchanged && cgrpEntries[i]->Unchanged;
+		}
+	}
 
-			if (!cgrp.Extract())
-			{
-				return false;
-			}
+	for (uint32_t i = 0; i < cgrpCount; ++i)
+	{
+		if ((cgrpEntries[i] == nullptr) || cgrpsUnchanged)
+		{
+			continue;
+		}
+
+		cgrpEntries[i]->Unchanged = false;
+		cgrpEntries[i]->Produced.Files.clear();
+
+		Common::Current.Produced = &cgrpEntries[i]->Produced;
+
+		pos = cgrpData[i];
+
+		uint32_t cgrpLength = cgrpLengths[i];
+
+		if (Common::DumpFiles)
+		{
+			Common::Write(outPath / (cgrps[i].FileName + ".bcgrp"), pos, cgrpLength);
 		}
+
+		string fileName = cgrps[i].FileName;
+
+		Job* cgrpJob = tasks.Run([this, pos, cgrpLength, outPath, fileName]
+		{
+			Cgrp cgrp(string(fileName + ".bcgrp").c_str(), pos, cgrpLength, &Resources, P, Workers);
+			cgrp.Shared = Shared;
+
+			return cgrp.Extract(outPath);
+		}, cgrpDependencies);
+
+		cgrpDependencies = { cgrpJob };
+
+		Common::Current.Produced = nullptr;
+	}
+
+	bool result = tasks.Wait();
+
+	if (Shared != nullptr)
+	{
+		Shared->Save(outPath / path(FileName).filename().replace_extension("sf2"));
 	}
 
-	Common::Dump(FileName.substr(0, FileName.length() - 5).append("log"));
+	if (!result)
+	{
+		return false;
+	}
+
+	Common::Dump(outPath / path(FileName).filename().replace_extension("log"));
+
+	manifest.Save();
 
 	return true;
 }
@@ -1,10 +1,14 @@
 #pragma once
 
-#include "Cwar.hpp"
+#include "Common.hpp"
+#include "Index.hpp"
+#include "Library.hpp"
+#include "Mmap.hpp"
+#include "Pool.hpp"
 
 #include <cstdint>
+#include <filesystem>
 #include <ios>
-#include <map>
 #include <string>
 
 struct CsarStrg
@@ -15,47 +19,21 @@ struct CsarStrg
 	std::string String;
 };
 
-struct CsarFile
-{
-	uint8_t* Offset;
-	uint32_t Length;
-
-	std::string Location = "";
-};
-
-struct CsarCbnk
-{
-	uint8_t* Offset;
-
-	uint32_t Id;
-	std::string FileName;
-};
-
-struct CsarCseq
-{
-	uint8_t* Offset;
-
-	std::string FileName;
-};
-
-struct CsarCgrp
-{
-	uint8_t* Offset;
-
-	uint32_t Id;
-	std::string FileName;
-};
-
 struct Csar
 {
 	std::string FileName;
 	std::streamoff Length;
 	uint8_t* Data = nullptr;
+	Mmap* File = nullptr;
 
-	std::map<int, Cwar*> Cwars;
+	Index Resources;
+	Library* Shared = nullptr;
 	bool P;
+	Pool* Workers;
+
+	Diagnostics Diag;
 
-	Csar(const char* fileName, bool p);
+	Csar(const char* fileName, bool p, Pool* workers);
 	~Csar();
-	bool Extract();
+	bool Extract(std::filesystem::path outPath);
 };
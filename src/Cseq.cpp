@@ -1,44 +1,47 @@
 #include "Cseq.hpp"
 #include "Common.hpp"
+#include "Mmap.hpp"
 
 #include "libsmfc/libsmfc.h"
 #include "libsmfc/libsmfcx.h"
 
 #include <cstdint>
-#include <fstream>
+#include <filesystem>
 #include <iterator>
 #include <map>
 #include <stack>
 #include <string>
+#include <utility>
 #include <vector>
 
 using namespace std;
+using namespace filesystem;
 
 vector<int32_t> ReadArgs(uint8_t*& pos, ArgType argType)
 {
 	if (argType == ArgType::Uint8)
 	{
-		return { ReadFixLen(pos, 1) };
+		return { Read<uint8_t>(pos) };
 	}
 	else if (argType == ArgType::Int8)
 	{
-		return { ReadFixLen(pos, 1, false, true) };
+		return { Read<int8_t>(pos) };
 	}
 	else if (argType == ArgType::Uint16)
 	{
-		return { ReadFixLen(pos, 2, false) };
+		return { Read<uint16_t, Endian::Big>(pos) };
 	}
 	else if (argType == ArgType::Int16)
 	{
-		return { ReadFixLen(pos, 2, false, true) };
+		return { Read<int16_t, Endian::Big>(pos) };
 	}
 	else if (argType == ArgType::Rnd)
 	{
-		return { ReadFixLen(pos, 2, false, true), ReadFixLen(pos, 2, false, true) };
+		return { Read<int16_t, Endian::Big>(pos), Read<int16_t, Endian::Big>(pos) };
 	}
 	else if (argType == ArgType::Var)
 	{
-		return { ReadFixLen(pos, 1) };
+		return { Read<uint8_t>(pos) };
 	}
 	else if (argType == ArgType::VarLen)
 	{
@@ -50,61 +53,68 @@ vector<int32_t> ReadArgs(uint8_t*& pos, ArgType argType)
 
 Cseq::Cseq(const char* fileName) : FileName(fileName)
 {
-	ifstream ifs(FileName, ios::binary | ios::ate);
+	File = new Mmap(FileName.c_str());
 
-	Length = ifs.tellg();
-	Data = new uint8_t[Length];
-
-	Common::Push(FileName, Data);
+	Length = File->Length;
+	Data = File->Data;
+}
 
-	ifs.seekg(0, ios::beg);
-	ifs.read(reinterpret_cast<char*>(Data), Length);
-	ifs.close();
+Cseq::Cseq(const char* fileName, uint8_t* data, streamoff length) : FileName(fileName), Length(length), Data(data)
+{
 }
 
 Cseq::~Cseq()
 {
+	delete File;
+}
+
+bool Cseq::Convert(path outPath)
+{
+	Common::Push(FileName, Data, Length);
+
+	bool result = Parse(outPath);
+
 	Common::Pop();
 
-	delete[] Data;
+	return result;
 }
 
-bool Cseq::Convert()
+bool Cseq::Parse(path outPath)
 {
 	uint8_t* pos = Data;
 
-	if (!Common::Assert(pos, 0x43534551, ReadFixLen(pos, 4, false))) { return false; }
-	if (!Common::Assert(pos, 0xFEFF, ReadFixLen(pos, 2))) { return false; }
-	if (!Common::Assert(pos, 0x40, ReadFixLen(pos, 2))) { return false; }
+	if (!Common::Assert(pos, 0x43534551, Read<uint32_t, Endian::Big>(pos))) { return false; }
+	if (!Common::Assert(pos, 0xFEFF, Read<uint16_t>(pos))) { return false; }
+	if (!Common::Assert(pos, 0x40, Read<uint16_t>(pos))) { return false; }
 
-	uint32_t cseqVersion = ReadFixLen(pos, 4);
+	uint32_t cseqVersion = Read<uint32_t>(pos);
 
-	if (!Common::Assert<uint64_t>(pos, Length, ReadFixLen(pos, 4))) { return false; }
-	if (!Common::Assert(pos, 0x2, ReadFixLen(pos, 4))) { return false; }
-	if (!Common::Assert(pos, 0x5000, ReadFixLen(pos, 4))) { return false; }
+	if (!Common::Assert<uint64_t>(pos, Length, Read<uint32_t>(pos))) { return false; }
+	if (!Common::Assert(pos, 0x2, Read<uint32_t>(pos))) { return false; }
+	if (!Common::Assert(pos, 0x5000, Read<uint32_t>(pos))) { return false; }
 
-	uint32_t dataOffset = ReadFixLen(pos, 4);
-	uint32_t dataLength = ReadFixLen(pos, 4);
+	uint32_t dataOffset = Read<uint32_t>(pos);
+	uint32_t dataLength = Read<uint32_t>(pos);
 
-	if (!Common::Assert(pos, 0x5001, ReadFixLen(pos, 4))) { return false; }
+	if (!Common::Assert(pos, 0x5001, Read<uint32_t>(pos))) { return false; }
 
-	uint32_t lablOffset = ReadFixLen(pos, 4);
-	uint32_t lablLength = ReadFixLen(pos, 4);
+	uint32_t lablOffset = Read<uint32_t>(pos);
+	uint32_t lablLength = Read<uint32_t>(pos);
 
 	pos = Data + lablOffset;
 
-	if (!Common::Assert(pos, 0x4C41424C, ReadFixLen(pos, 4, false))) { return false; }
-	if (!Common::Assert<uint32_t>(pos, lablLength, ReadFixLen(pos, 4))) { return false; }
+	if (!Common::Assert(pos, 0x4C41424C, Read<uint32_t, Endian::Big>(pos))) { return false; }
+	if (!Common::Assert<uint32_t>(pos, lablLength, Read<uint32_t>(pos))) { return false; }
 
-	uint32_t lablCount = ReadFixLen(pos, 4);
+	uint32_t lablCount = Read<uint32_t>(pos);
 
 	vector<uint8_t*> lablOffsets;
 
 	for (uint32_t i = 0; i < lablCount; ++i)
 	{
-		if (!Common::Assert(pos, 0x5100, ReadFixLen(pos, 4))) { return false; }
+		if (!Common::Assert(pos, 0x5100, Read<uint32_t>(pos))) { return false; }
 
-		lablOffsets.push_back(Data + lablOffset + 8 + ReadFixLen(pos, 4));
+		lablOffsets.push_back(Data + lablOffset + 8 + Read<uint32_t>(pos));
 	}
 
 	map<uint8_t*, CseqLabl> labls;
@@ -113,11 +123,11 @@ bool Cseq::Convert()
 	{
 		pos = lablOffsets[i];
 
-		if (!Common::Assert(pos, 0x1F00, ReadFixLen(pos, 4))) { return false; }
+		if (!Common::Assert(pos, 0x1F00, Read<uint32_t>(pos))) { return false; }
 
 		CseqLabl labl;
-		labl.Offset = Data + dataOffset + 8 + ReadFixLen(pos, 4);
-		uint32_t lablLength = ReadFixLen(pos, 4);
+		labl.Offset = Data + dataOffset + 8 + Read<uint32_t>(pos);
+		uint32_t lablLength = Read<uint32_t>(pos);
 		labl.Label = string(reinterpret_cast<const char*>(pos), lablLength);
 
 		labls[labl.Offset] = labl;
@@ -125,8 +135,8 @@ bool Cseq::Convert()
 
 	pos = Data + dataOffset;
 
-	if (!Common::Assert(pos, 0x44415441, ReadFixLen(pos, 4, false))) { return false; }
-	if (!Common::Assert<uint32_t>(pos, dataLength, ReadFixLen(pos, 4))) { return false; }
+	if (!Common::Assert(pos, 0x44415441, Read<uint32_t, Endian::Big>(pos))) { return false; }
+	if (!Common::Assert<uint32_t>(pos, dataLength, Read<uint32_t>(pos))) { return false; }
 
 	map<uint32_t, CseqCmd> commands;
 
@@ -140,13 +150,13 @@ bool Cseq::Convert()
 			cmd.Label = labls[pos].Label;
 		}
 
-		uint8_t statusByte = ReadFixLen(pos, 1);
+		uint8_t statusByte = Read<uint8_t>(pos);
 
 		if (statusByte == 0xA2)
 		{
 			cmd.Suffix3 = SuffixType::If;
 
-			statusByte = ReadFixLen(pos, 1);
+			statusByte = Read<uint8_t>(pos);
 		}
 
 		if (statusByte == 0xA3)
@@ -154,21 +164,21 @@ bool Cseq::Convert()
 			cmd.Suffix2 = SuffixType::Time;
 			cmd.Arg2 = ArgType::Int16;
 
-			statusByte = ReadFixLen(pos, 1);
+			statusByte = Read<uint8_t>(pos);
 		}
 		else if (statusByte == 0xA4)
 		{
 			cmd.Suffix2 = SuffixType::TimeRnd;
 			cmd.Arg2 = ArgType::Rnd;
 
-			statusByte = ReadFixLen(pos, 1);
+			statusByte = Read<uint8_t>(pos);
 		}
 		else if (statusByte == 0xA5)
 		{
 			cmd.Suffix2 = SuffixType::TimeVar;
 			cmd.Arg2 = ArgType::Var;
 
-			statusByte = ReadFixLen(pos, 1);
+			statusByte = Read<uint8_t>(pos);
 		}
 
 		if (statusByte == 0xA0)
@@ -176,21 +186,21 @@ bool Cseq::Convert()
 			cmd.Suffix1 = SuffixType::Rnd;
 			cmd.Arg1 = ArgType::Rnd;
 
-			statusByte = ReadFixLen(pos, 1);
+			statusByte = Read<uint8_t>(pos);
 		}
 		else if (statusByte == 0xA1)
 		{
 			cmd.Suffix1 = SuffixType::Var;
 			cmd.Arg1 = ArgType::Var;
 
-			statusByte = ReadFixLen(pos, 1);
+			statusByte = Read<uint8_t>(pos);
 		}
 
 		cmd.Cmd = statusByte;
 
 		if (statusByte < 0x80)
 		{
-			cmd.Args.push_back(ReadFixLen(pos, 1));
+			cmd.Args.push_back(Read<uint8_t>(pos));
 
 			if (cmd.Arg1 == ArgType::None)
 			{
@@ -214,20 +224,20 @@ bool Cseq::Convert()
 		}
 		else if (statusByte == 0x88)
 		{
-			cmd.Args.push_back(ReadFixLen(pos, 1));
-			cmd.Args.push_back(ReadFixLen(pos, 3, false));
+			cmd.Args.push_back(Read<uint8_t>(pos));
+			cmd.Args.push_back(static_cast<int32_t>(Read<uint32_t, Endian::Big, 3>(pos)));
 		}
 		else if ((statusByte == 0x89) || (statusByte == 0x8A))
 		{
-			cmd.Args.push_back(ReadFixLen(pos, 3, false));
+			cmd.Args.push_back(static_cast<int32_t>(Read<uint32_t, Endian::Big, 3>(pos)));
 		}
 		else if (statusByte == 0x90)
 		{
-			Common::Analyse("Cseq Cmd 0x90", ReadFixLen(pos, 2, false));
+			Common::Analyse("Cseq Cmd 0x90", Read<uint16_t, Endian::Big>(pos));
 		}
 		else if (statusByte == 0x96)
 		{
-			Common::Analyse("Cseq Cmd 0x96", ReadFixLen(pos, 2, false));
+			Common::Analyse("Cseq Cmd 0x96", Read<uint16_t, Endian::Big>(pos));
 		}
 		else if ((statusByte >= 0xB0) && (statusByte <= 0xDF))
 		{
@@ -245,11 +255,11 @@ bool Cseq::Convert()
 			}
 			else if ((statusByte == 0xB2) || (statusByte == 0xBF) || (statusByte == 0xC7) || (statusByte == 0xC8) || (statusByte == 0xC9) || (statusByte == 0xCE) || (statusByte == 0xDF))
 			{
-				cmd.Args.push_back(ReadFixLen(pos, 1));
+				cmd.Args.push_back(Read<uint8_t>(pos));
 			}
 			else if (statusByte == 0xCC)
 			{
-				cmd.Args.push_back(ReadFixLen(pos, 1));
+				cmd.Args.push_back(Read<uint8_t>(pos));
 
 				if (cmd.Args.back() > 2)
 				{
@@ -298,7 +308,7 @@ bool Cseq::Convert()
 		{
 			cmd.Extended = true;
 
-			statusByte = ReadFixLen(pos, 1);
+			statusByte = Read<uint8_t>(pos);
 
 			if (((statusByte >= 0x80) && (statusByte <= 0x8B)) || ((statusByte >= 0x90) && (statusByte <= 0x95)))
 			{
@@ -317,7 +327,7 @@ bool Cseq::Convert()
 			}
 			else if (statusByte == 0xA4)
 			{
-				cmd.Args.push_back(ReadFixLen(pos, 1));
+				cmd.Args.push_back(Read<uint8_t>(pos));
 
 				if (cmd.Args.back() > 2)
 				{
@@ -328,7 +338,7 @@ bool Cseq::Convert()
 			}
 			else if (statusByte == 0xAA)
 			{
-				cmd.Args.push_back(ReadFixLen(pos, 1));
+				cmd.Args.push_back(Read<uint8_t>(pos));
 
 				if (cmd.Args.back() > 2)
 				{
@@ -339,7 +349,7 @@ bool Cseq::Convert()
 			}
 			else if (statusByte == 0xB0)
 			{
-				cmd.Args.push_back(ReadFixLen(pos, 1));
+				cmd.Args.push_back(Read<uint8_t>(pos));
 
 				if (cmd.Args.back() > 2)
 				{
@@ -394,7 +404,7 @@ bool Cseq::Convert()
 		}
 		else if (statusByte == 0xFE)
 		{
-			cmd.Args.push_back(ReadFixLen(pos, 2, false));
+			cmd.Args.push_back(Read<uint16_t, Endian::Big>(pos));
 		}
 		else
 		{
@@ -883,8 +893,11 @@ bool Cseq::Convert()
 		smfSetTimebase(smf, 48);
 	}
 
-	smfWriteFile(smf, FileName.substr(0, FileName.length() - 5).append("mid").c_str());
+	vector<uint8_t> midData(smfGetSize(smf));
+	smfWrite(smf, midData.data(), midData.size());
 	smfDelete(smf);
 
+	Common::Write(outPath / FileName.substr(0, FileName.length() - 5).append("mid"), move(midData));
+
 	return true;
 }
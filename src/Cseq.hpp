@@ -1,6 +1,9 @@
 #pragma once
 
+#include "Mmap.hpp"
+
 #include <cstdint>
+#include <filesystem>
 #include <ios>
 #include <string>
 #include <vector>
@@ -36,8 +39,11 @@ struct Cseq
 	std::string FileName;
 	std::streamoff Length;
 	uint8_t* Data = nullptr;
+	Mmap* File = nullptr;
 
 	Cseq(const char* fileName);
+	Cseq(const char* fileName, uint8_t* data, std::streamoff length);
 	~Cseq();
-	bool Convert();
+	bool Convert(std::filesystem::path outPath);
+	bool Parse(std::filesystem::path outPath);
 };
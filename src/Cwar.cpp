@@ -1,25 +1,33 @@
 #include "Cwar.hpp"
 #include "Common.hpp"
 #include "Cwav.hpp"
-
-#include <fstream>
+#include "Dsp.hpp"
+#include "Mmap.hpp"
+#include "Pool.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <mutex>
 #include <string>
 #include <vector>
 
 using namespace std;
+using namespace filesystem;
 
-Cwar::Cwar(const char* fileName) : FileName(fileName)
-{
-	ifstream ifs(FileName, ios::binary | ios::ate);
+// Enough waves to fill the widest lanes with mono channels, few enough to keep the pool busy and the buffers bounded
+const size_t ConvertBatch = 8;
 
-	Length = ifs.tellg();
-	Data = new uint8_t[Length];
+Cwar::Cwar(const char* fileName, Pool* workers) : FileName(fileName), Workers(workers)
+{
+	File = new Mmap(FileName.c_str());
 
-	Common::Push(FileName, Data);
+	Length = File->Length;
+	Data = File->Data;
+}
 
-	ifs.seekg(0, ios::beg);
-	ifs.read(reinterpret_cast<char*>(Data), Length);
-	ifs.close();
+Cwar::Cwar(const char* fileName, uint8_t* data, streamoff length, Pool* workers) : FileName(fileName), Length(length), Data(data), Workers(workers)
+{
 }
 
 Cwar::~Cwar()
@@ -29,71 +37,154 @@ Cwar::~Cwar()
 		delete cwav;
 	}
 
+	delete File;
+}
+
+bool Cwar::Extract(path outPath)
+{
+	Common::Push(FileName, Data, Length);
+
+	bool result = Parse(outPath);
+
 	Common::Pop();
 
-	delete[] Data;
+	return result;
 }
 
-bool Cwar::Extract()
+bool Cwar::Parse(path outPath)
 {
 	uint8_t* pos = Data;
 
-	if (!Common::Assert(pos, 0x43574152, ReadFixLen(pos, 4, false))) { return false; }
-	if (!Common::Assert(pos, 0xFEFF, ReadFixLen(pos, 2))) { return false; }
-	if (!Common::Assert(pos, 0x40, ReadFixLen(pos, 2))) { return false; }
+	if (!Common::Assert(pos, 0x43574152, Read<uint32_t, Endian::Big>(pos))) { return false; }
+	if (!Common::Assert(pos, 0xFEFF, Read<uint16_t>(pos))) { return false; }
+	if (!Common::Assert(pos, 0x40, Read<uint16_t>(pos))) { return false; }
 
-	uint32_t cwarVersion = ReadFixLen(pos, 4);
+	uint32_t cwarVersion = Read<uint32_t>(pos);
 
-	if (!Common::Assert<uint64_t>(pos, Length, ReadFixLen(pos, 4))) { return false; }
-	if (!Common::Assert(pos, 0x2, ReadFixLen(pos, 4))) { return false; }
-	if (!Common::Assert(pos, 0x6800, ReadFixLen(pos, 4))) { return false; }
+	if (!Common::Assert<uint64_t>(pos, Length, Read<uint32_t>(pos))) { return false; }
+	if (!Common::Assert(pos, 0x2, Read<uint32_t>(pos))) { return false; }
+	if (!Common::Assert(pos, 0x6800, Read<uint32_t>(pos))) { return false; }
 
-	uint32_t infoOffset = ReadFixLen(pos, 4);
-	uint32_t infoLength = ReadFixLen(pos, 4);
+	uint32_t infoOffset = Read<uint32_t>(pos);
+	uint32_t infoLength = Read<uint32_t>(pos);
 
-	if (!Common::Assert(pos, 0x6801, ReadFixLen(pos, 4))) { return false; }
+	if (!Common::Assert(pos, 0x6801, Read<uint32_t>(pos))) { return false; }
 
-	uint32_t fileOffset = ReadFixLen(pos, 4);
-	uint32_t fileLength = ReadFixLen(pos, 4);
+	uint32_t fileOffset = Read<uint32_t>(pos);
+	uint32_t fileLength = Read<uint32_t>(pos);
 
 	pos = Data + infoOffset;
 
-	if (!Common::Assert(pos, 0x494E464F, ReadFixLen(pos, 4, false))) { return false; }
-	if (!Common::Assert<uint32_t>(pos, infoLength, ReadFixLen(pos, 4))) { return false; }
+	if (!Common::Assert(pos, 0x494E464F, Read<uint32_t, Endian::Big>(pos))) { return false; }
+	if (!Common::Assert<uint32_t>(pos, infoLength, Read<uint32_t>(pos))) { return false; }
 
-	uint32_t cwavCount = ReadFixLen(pos, 4);
+	uint32_t cwavCount = Read<uint32_t>(pos);
 
 	vector<CwarCwav> cwavs;
 
 	for (uint32_t i = 0; i < cwavCount; ++i)
 	{
-		if (!Common::Assert(pos, 0x1F00, ReadFixLen(pos, 4))) { return false; }
+		if (!Common::Assert(pos, 0x1F00, Read<uint32_t>(pos))) { return false; }
 
 		CwarCwav cwav{};
-		cwav.Offset = Data + fileOffset + 8 + ReadFixLen(pos, 4);
-		cwav.Length = ReadFixLen(pos, 4);
+		cwav.Offset = Data + fileOffset + 8 + Read<uint32_t>(pos);
+		cwav.Length = Read<uint32_t>(pos);
 
 		cwavs.push_back(cwav);
 	}
 
 	pos = Data + fileOffset;
 
-	if (!Common::Assert(pos, 0x46494C45, ReadFixLen(pos, 4, false))) { return false; }
-	if (!Common::Assert<uint32_t>(pos, fileLength, ReadFixLen(pos, 4))) { return false; }
+	if (!Common::Assert(pos, 0x46494C45, Read<uint32_t, Endian::Big>(pos))) { return false; }
+	if (!Common::Assert<uint32_t>(pos, fileLength, Read<uint32_t>(pos))) { return false; }
+
+	Tasks tasks(Workers);
 
 	for (uint32_t i = 0; i < cwavCount; ++i)
 	{
-		ofstream ofs(string(to_string(i) + ".bcwav"), ofstream::binary);
-		ofs.write(reinterpret_cast<const char*>(cwavs[i].Offset), cwavs[i].Length);
-		ofs.close();
+		if (Common::DumpFiles && !Keep)
+		{
+			Common::Write(outPath / (to_string(i) + ".bcwav"), cwavs[i].Offset, cwavs[i].Length);
+		}
+
+		Cwavs.push_back(new Cwav(string(to_string(i) + ".bcwav").c_str(), cwavs[i].Offset, cwavs[i].Length));
+
+		Cwav* cwav = Cwavs[i];
+		cwav->Keep = Keep;
+		cwav->Origin = Common::Current;
+		cwav->OutPath = outPath;
+	}
+
+	// Under -r a wave is only decoded once a bank asks for it
+	if (!Common::OnDemand)
+	{
+		for (size_t i = 0; i < Cwavs.size(); i += ConvertBatch)
+		{
+			size_t count = min(ConvertBatch, Cwavs.size() - i);
+
+			tasks.Run([this, i, count, outPath] { return Convert(i, count, outPath); });
+		}
+	}
+
+	return tasks.Wait();
+}
+
+// Converts a run of sibling waves at once, so that their DSP channels, mono ones included, share SIMD lanes
+bool Cwar::Convert(size_t first, size_t count, path outPath)
+{
+	vector<unique_lock<mutex>> locks;
+	vector<Cwav*> pending;
+	vector<DspStream> streams;
+	bool result = true;
+
+	for (size_t i = first; i < first + count; ++i)
+	{
+		Cwav* cwav = Cwavs[i];
 
-		Cwavs.push_back(new Cwav(string(to_string(i) + ".bcwav").c_str()));
+		unique_lock<mutex> lock(cwav->Mutex);
 
-		if (!Cwavs[i]->Convert())
+		// A bank may already have demanded this wave
+		if (cwav->Converted)
 		{
-			return false;
+			result = result && cwav->Result;
+
+			continue;
 		}
+
+		Common::Push(cwav->FileName, cwav->Data, cwav->Length);
+
+		cwav->Result = cwav->Prepare(outPath);
+
+		Common::Pop();
+
+		if (!cwav->Result || (cwav->Pending == nullptr))
+		{
+			cwav->Converted = true;
+			result = result && cwav->Result;
+
+			continue;
+		}
+
+		if (cwav->Codec == 2)
+		{
+			cwav->AddDspStreams(streams, 0, cwav->ChanCount, cwav->Pending, cwav->ChanCount);
+		}
+		else
+		{
+			cwav->Decode(0, cwav->ChanCount, cwav->Pending, cwav->ChanCount);
+		}
+
+		pending.push_back(cwav);
+		locks.push_back(move(lock));
+	}
+
+	DecodeDsp(streams.data(), streams.size());
+
+	for (Cwav* cwav : pending)
+	{
+		cwav->Finish();
+		cwav->Converted = true;
 	}
 
-	return true;
+	return result;
 }
@@ -1,8 +1,12 @@
 #pragma once
 
 #include "Cwav.hpp"
+#include "Mmap.hpp"
+#include "Pool.hpp"
 
+#include <cstddef>
 #include <cstdint>
+#include <filesystem>
 #include <ios>
 #include <string>
 #include <vector>
@@ -18,10 +22,16 @@ struct Cwar
 	std::string FileName;
 	std::streamoff Length;
 	uint8_t* Data = nullptr;
+	Mmap* File = nullptr;
 
 	std::vector<Cwav*> Cwavs;
+	Pool* Workers;
+	bool Keep = false;
 
-	Cwar(const char* fileName);
+	Cwar(const char* fileName, Pool* workers);
+	Cwar(const char* fileName, uint8_t* data, std::streamoff length, Pool* workers);
 	~Cwar();
-	bool Extract();
+	bool Extract(std::filesystem::path outPath);
+	bool Parse(std::filesystem::path outPath);
+	bool Convert(size_t first, size_t count, std::filesystem::path outPath);
 };
@@ -1,209 +1,246 @@
 #include "Cwav.hpp"
+#include "Cache.hpp"
 #include "Common.hpp"
-
-#include <algorithm>
-#include <cmath>
-#include <fstream>
+#include "Dsp.hpp"
+#include "Ima.hpp"
+#include "Mmap.hpp"
+#include "Pcm.hpp"
+#include "Sink.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <ios>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <system_error>
 #include <vector>
 
 using namespace std;
+using namespace filesystem;
+
+static void Put(uint8_t*& pos, const void* data, size_t length)
+{
+	memcpy(pos, data, length);
 
-const int8_t nibbles[] = { 0, 1, 2, 3, 4, 5, 6, 7, -8, -7, -6, -5, -4, -3, -2, -1 };
+	pos += length;
+}
 
 Cwav::Cwav(const char* fileName) : FileName(fileName)
 {
-	ifstream ifs(FileName, ios::binary | ios::ate);
-
-	Length = ifs.tellg();
-	Data = new uint8_t[Length];
+	File = new Mmap(FileName.c_str());
 
-	Common::Push(FileName, Data);
+	Length = File->Length;
+	Data = File->Data;
+}
 
-	ifs.seekg(0, ios::beg);
-	ifs.read(reinterpret_cast<char*>(Data), Length);
-	ifs.close();
+Cwav::Cwav(const char* fileName, uint8_t* data, streamoff length) : FileName(fileName), Length(length), Data(data)
+{
 }
 
 Cwav::~Cwav()
 {
+	delete File;
+}
+
+bool Cwav::Convert(path outPath)
+{
+	lock_guard<mutex> lock(Mutex);
+
+	if (Converted)
+	{
+		return Result;
+	}
+
+	Common::Push(FileName, Data, Length);
+
+	Result = Parse(outPath);
+	Converted = true;
+
 	Common::Pop();
 
-	delete[] Data;
+	return Result;
+}
+
+bool Cwav::Demand()
+{
+	{
+		lock_guard<mutex> lock(Mutex);
+
+		if (Converted)
+		{
+			return Result;
+		}
+	}
+
+	// A wave decoded on demand belongs to its wave archive, not to the bank that asked for it
+	Context saved = move(Common::Current);
+	Common::Current = Origin;
+
+	bool result = Convert(OutPath);
+
+	Common::Current = move(saved);
+
+	return result;
+}
+
+bool Cwav::Parse(path outPath)
+{
+	if (!Prepare(outPath))
+	{
+		return false;
+	}
+
+	if (Pending != nullptr)
+	{
+		Decode(0, ChanCount, Pending, ChanCount);
+		Finish();
+	}
+
+	return true;
 }
 
-bool Cwav::Convert()
+// Reads the wave and lays out its WAV, leaving Pending set if the samples still have to be decoded into it
+bool Cwav::Prepare(path outPath)
 {
+	Pending = nullptr;
+
 	uint8_t* pos = Data;
 
-	if (!Common::Assert(pos, 0x43574156, ReadFixLen(pos, 4, false))) { return false; }
-	if (!Common::Assert(pos, 0xFEFF, ReadFixLen(pos, 2))) { return false; }
-	if (!Common::Assert(pos, 0x40, ReadFixLen(pos, 2))) { return false; }
+	if (!Common::Assert(pos, 0x43574156, Read<uint32_t, Endian::Big>(pos))) { return false; }
+	if (!Common::Assert(pos, 0xFEFF, Read<uint16_t>(pos))) { return false; }
+	if (!Common::Assert(pos, 0x40, Read<uint16_t>(pos))) { return false; }
 
-	uint32_t cwavVersion = ReadFixLen(pos, 4);
+	uint32_t cwavVersion = Read<uint32_t>(pos);
 
-	if (!Common::Assert<uint64_t>(pos, Length, ReadFixLen(pos, 4))) { return false; }
-	if (!Common::Assert(pos, 0x2, ReadFixLen(pos, 4))) { return false; }
-	if (!Common::Assert(pos, 0x7000, ReadFixLen(pos, 4))) { return false; }
+	if (!Common::Assert<uint64_t>(pos, Length, Read<uint32_t>(pos))) { return false; }
+	if (!Common::Assert(pos, 0x2, Read<uint32_t>(pos))) { return false; }
+	if (!Common::Assert(pos, 0x7000, Read<uint32_t>(pos))) { return false; }
 
-	uint32_t infoOffset = ReadFixLen(pos, 4);
-	uint32_t infoLength = ReadFixLen(pos, 4);
+	uint32_t infoOffset = Read<uint32_t>(pos);
+	uint32_t infoLength = Read<uint32_t>(pos);
 
-	if (!Common::Assert(pos, 0x7001, ReadFixLen(pos, 4))) { return false; }
+	if (!Common::Assert(pos, 0x7001, Read<uint32_t>(pos))) { return false; }
 
-	uint32_t dataOffset = ReadFixLen(pos, 4);
-	uint32_t dataLength = ReadFixLen(pos, 4);
+	uint32_t dataOffset = Read<uint32_t>(pos);
+	uint32_t dataLength = Read<uint32_t>(pos);
 
 	pos = Data + infoOffset;
 
-	if (!Common::Assert(pos, 0x494E464F, ReadFixLen(pos, 4, false))) { return false; }
-	if (!Common::Assert<uint32_t>(pos, infoLength, ReadFixLen(pos, 4))) { return false; }
+	if (!Common::Assert(pos, 0x494E464F, Read<uint32_t, Endian::Big>(pos))) { return false; }
+	if (!Common::Assert<uint32_t>(pos, infoLength, Read<uint32_t>(pos))) { return false; }
 
-	uint8_t codec = ReadFixLen(pos, 1);
-	SampleMode = ReadFixLen(pos, 1);
+	Codec = Read<uint8_t>(pos);
+	SampleMode = Read<uint8_t>(pos);
 
-	if (!Common::Assert(pos, 0x0, ReadFixLen(pos, 2))) { return false; }
+	if (!Common::Assert(pos, 0x0, Read<uint16_t>(pos))) { return false; }
 
-	uint32_t sampleRate = ReadFixLen(pos, 4);
-	uint32_t loopStart = ReadFixLen(pos, 4);
-	uint32_t loopEnd = ReadFixLen(pos, 4);
-	uint32_t unalignedLoopStart = ReadFixLen(pos, 4);
-	uint16_t chanCount = ReadFixLen(pos, 2);
+	SampleRate = Read<uint32_t>(pos);
+	LoopStart = Read<uint32_t>(pos);
+	LoopEnd = Read<uint32_t>(pos);
+	uint32_t unalignedLoopStart = Read<uint32_t>(pos);
+	ChanCount = Read<uint16_t>(pos);
 
-	if (!Common::Assert(pos, 0x0, ReadFixLen(pos, 2))) { return false; }
+	if (!Common::Assert(pos, 0x0, Read<uint16_t>(pos))) { return false; }
 
-	vector<CwavChan> chans;
-
-	for (uint16_t i = 0; i < chanCount; ++i)
+	for (uint16_t i = 0; i < ChanCount; ++i)
 	{
-		if (!Common::Assert(pos, 0x7100, ReadFixLen(pos, 4))) { return false; }
+		if (!Common::Assert(pos, 0x7100, Read<uint32_t>(pos))) { return false; }
 
 		CwavChan chan;
-		chan.Offset = Data + infoOffset + 28 + ReadFixLen(pos, 4);
+		chan.Offset = Data + infoOffset + 28 + Read<uint32_t>(pos);
 
-		chans.push_back(chan);
+		Chans.push_back(chan);
 	}
 
-	for (uint16_t i = 0; i < chanCount; ++i)
+	for (uint16_t i = 0; i < ChanCount; ++i)
 	{
-		pos = chans[i].Offset;
+		pos = Chans[i].Offset;
 
-		if (!Common::Assert(pos, 0x1F00, ReadFixLen(pos, 4))) { return false; }
+		if (!Common::Assert(pos, 0x1F00, Read<uint32_t>(pos))) { return false; }
 
-		chans[i].SampOffset = Data + dataOffset + 8 + ReadFixLen(pos, 4);
-		chans[i].AdpcmType = ReadFixLen(pos, 4);
-		uint32_t adpcmOffset = ReadFixLen(pos, 4);
+		Chans[i].SampOffset = Data + dataOffset + 8 + Read<uint32_t>(pos);
+		Chans[i].AdpcmType = Read<uint32_t>(pos);
+		uint32_t adpcmOffset = Read<uint32_t>(pos);
 
-		switch (codec)
-		{
-			case 0:
-			{
-				pos = chans[i].SampOffset;
+		uint64_t sampleBytes = Codec == 0 ? LoopEnd : Codec == 1 ? LoopEnd * 2ull : Codec == 2 ? ((LoopEnd + 13ull) / 14) * 8 : (LoopEnd + 1ull) / 2;
 
-				for (uint32_t j = 0; j < loopEnd; ++j)
-				{
-					chans[i].PcmSamples.push_back(ReadFixLen(pos, 1) << 8);
-				}
+		if ((Codec <= 3) && (Common::Remaining(Chans[i].SampOffset) < static_cast<ptrdiff_t>(sampleBytes)))
+		{
+			Common::Error(Chans[i].SampOffset, to_string(sampleBytes) + " bytes of samples", Common::Remaining(Chans[i].SampOffset));
 
-				break;
-			}
+			return false;
+		}
 
+		switch (Codec)
+		{
+			case 0:
 			case 1:
 			{
-				pos = chans[i].SampOffset;
-
-				for (uint32_t j = 0; j < loopEnd; ++j)
-				{
-					chans[i].PcmSamples.push_back(ReadFixLen(pos, 2, true, true));
-				}
-
 				break;
 			}
 
 			case 2:
 			{
-				chans[i].AdpcmOffset = chans[i].Offset + adpcmOffset;
+				Chans[i].AdpcmOffset = Chans[i].Offset + adpcmOffset;
 
-				pos = chans[i].AdpcmOffset;
+				pos = Chans[i].AdpcmOffset;
 
 				for (uint8_t j = 0; j < 16; ++j)
 				{
-					chans[i].DspCoeffs[j] = ReadFixLen(pos, 2, true, true);
+					Chans[i].DspCoeffs[j] = Read<int16_t>(pos);
 				}
 
 				DspContext dspCntx{};
-				dspCntx.PredScal = ReadFixLen(pos, 1);
+				dspCntx.PredScal = Read<uint8_t>(pos);
 
-				if (!Common::Assert(pos, 0x0, ReadFixLen(pos, 1))) { return false; }
+				if (!Common::Assert(pos, 0x0, Read<uint8_t>(pos))) { return false; }
 
-				dspCntx.SampHist1 = ReadFixLen(pos, 2, true, true);
-				dspCntx.SampHist2 = ReadFixLen(pos, 2, true, true);
+				dspCntx.SampHist1 = Read<int16_t>(pos);
+				dspCntx.SampHist2 = Read<int16_t>(pos);
 
 				DspContext dspLoopCntx{};
-				dspLoopCntx.PredScal = ReadFixLen(pos, 1);
-
-				if (!Common::Assert(pos, 0x0, ReadFixLen(pos, 1))) { return false; }
-
-				dspLoopCntx.SampHist1 = ReadFixLen(pos, 2, true, true);
-				dspLoopCntx.SampHist2 = ReadFixLen(pos, 2, true, true);
+				dspLoopCntx.PredScal = Read<uint8_t>(pos);
 
-				chans[i].DspCntx = dspCntx;
-				chans[i].DspLoopCntx = dspLoopCntx;
+				if (!Common::Assert(pos, 0x0, Read<uint8_t>(pos))) { return false; }
 
-				pos = chans[i].SampOffset;
+				dspLoopCntx.SampHist1 = Read<int16_t>(pos);
+				dspLoopCntx.SampHist2 = Read<int16_t>(pos);
 
-				int8_t predScal = chans[i].DspCntx.PredScal;
-				int16_t hist1 = chans[i].DspCntx.SampHist1;
-				int16_t hist2 = chans[i].DspCntx.SampHist2;
-
-				for (uint32_t j = 0; j < ceil(loopEnd / 14.0f); ++j)
-				{
-					predScal = ReadFixLen(pos, 1);
-					int32_t pred = (predScal >> 4) & 0xF;
-					int32_t scal = 1 << (predScal & 0xF);
-					int16_t coef1 = chans[i].DspCoeffs[pred * 2];
-					int16_t coef2 = chans[i].DspCoeffs[(pred * 2) + 1];
-
-					uint32_t samplesToRead = min<uint32_t>(14, loopEnd - chans[i].PcmSamples.size());
-
-					for (uint32_t k = 0; k < samplesToRead; ++k)
-					{
-						int32_t adpcm = k % 2 == 0 ? nibbles[*pos >> 4] : nibbles[ReadFixLen(pos, 1) & 0xF];
-						int32_t distance = (scal * adpcm) << 11;
-						int32_t predicted = (coef1 * hist1) + (coef2 * hist2);
-						int32_t corrected = predicted + distance;
-						int32_t scaled = (corrected + 1024) >> 11;
-
-						if (scaled < -32768)
-						{
-							chans[i].PcmSamples.push_back(-32768);
-						}
-						else if (scaled > 32767)
-						{
-							chans[i].PcmSamples.push_back(32767);
-						}
-						else
-						{
-							chans[i].PcmSamples.push_back(scaled);
-						}
-
-						hist2 = hist1;
-						hist1 = chans[i].PcmSamples.back();
-					}
-				}
+				Chans[i].DspCntx = dspCntx;
+				Chans[i].DspLoopCntx = dspLoopCntx;
 
 				break;
 			}
 
 			case 3:
 			{
-				Common::Warning(Data + infoOffset + 8, "IMA ADPCM decoding not implemented");
+				Chans[i].AdpcmOffset = Chans[i].Offset + adpcmOffset;
+
+				pos = Chans[i].AdpcmOffset;
+
+				ImaContext imaCntx{};
+				imaCntx.Data = Read<int16_t>(pos);
+				imaCntx.TableIndex = Read<uint8_t>(pos);
+
+				if (!Common::Assert(pos, 0x0, Read<uint8_t>(pos))) { return false; }
+
+				// The loop context only matters to a player resuming at the loop start, and the WAV holds every sample
+				pos += 3;
+
+				if (!Common::Assert(pos, 0x0, Read<uint8_t>(pos))) { return false; }
+
+				Chans[i].ImaCntx = imaCntx;
 
 				break;
 			}
 
 			default:
 			{
-				Common::Error(Data + infoOffset + 8, "A valid codec identifier", codec);
+				Common::Error(Data + infoOffset + 8, "A valid codec identifier", Codec);
 
 				return false;
 			}
@@ -213,71 +250,292 @@ bool Cwav::Convert()
 	uint32_t fmtLength = 16;
 	uint16_t waveCodec = 1;
 	uint16_t bitsPerSample = 16;
-	uint32_t byteRate = (sampleRate * chanCount) * (bitsPerSample / 8);
-	uint16_t blockAlign = chanCount * (bitsPerSample / 8);
-	uint32_t waveDataLength = (chans[0].PcmSamples.size() * chanCount) * (bitsPerSample / 8);
-	uint32_t length = 36 + waveDataLength;
+	uint32_t byteRate = (SampleRate * ChanCount) * (bitsPerSample / 8);
+	uint16_t blockAlign = ChanCount * (bitsPerSample / 8);
+	uint64_t waveDataBytes = (static_cast<uint64_t>(LoopEnd) * ChanCount) * (bitsPerSample / 8);
 
 	uint32_t smplLength = 60;
-	uint32_t zero = 0;
-	uint32_t sampleLoops = 1;
 
-	if ((SampleMode % 2) != 0)
+	uint64_t lengthBytes = 36 + waveDataBytes + (((SampleMode % 2) != 0) ? (8 + smplLength) : 0);
+
+	if (lengthBytes > 0xFFFFFFFF)
 	{
-		length += 8 + smplLength;
+		Common::Error(Data + infoOffset + 8, "A wave that fits in a WAV file", lengthBytes);
+
+		return false;
 	}
 
-	ofstream ofs(FileName.substr(0, FileName.length() - 5).append("wav"), ofstream::binary);
-
-	ofs.write("RIFF", 4);
-	ofs.write(reinterpret_cast<const char*>(&length), 4);
-	ofs.write("WAVE", 4);
-	ofs.write("fmt ", 4);
-	ofs.write(reinterpret_cast<const char*>(&fmtLength), 4);
-	ofs.write(reinterpret_cast<const char*>(&waveCodec), 2);
-	ofs.write(reinterpret_cast<const char*>(&chanCount), 2);
-	ofs.write(reinterpret_cast<const char*>(&sampleRate), 4);
-	ofs.write(reinterpret_cast<const char*>(&byteRate), 4);
-	ofs.write(reinterpret_cast<const char*>(&blockAlign), 2);
-	ofs.write(reinterpret_cast<const char*>(&bitsPerSample), 2);
-	ofs.write("data", 4);
-	ofs.write(reinterpret_cast<const char*>(&waveDataLength), 4);
-
-	for (size_t i = 0; i < chans[0].PcmSamples.size(); ++i)
+	uint32_t waveDataLength = static_cast<uint32_t>(waveDataBytes);
+	uint32_t length = static_cast<uint32_t>(lengthBytes);
+
+	// The whole WAV is laid out up front so that the samples can be decoded straight into it
+	WavePath = outPath / FileName.substr(0, FileName.length() - 5).append("wav");
+	Cached.clear();
+
+	// The WAV of a wave that has not changed since the last run is left as it is
+	if (Keep && Map(WavePath, 8 + length))
+	{
+		return true;
+	}
+
+	// A wave that has been decoded before, by this run or an earlier one, is taken from the cache instead
+	if (Common::Decoded != nullptr)
 	{
-		for (uint16_t j = 0; j < chanCount; ++j)
+		Cached = Common::Decoded->Entry(Data, static_cast<size_t>(Length), "wav");
+
+		if (Map(Cached, 8 + length))
 		{
-			ofs.write(reinterpret_cast<const char*>(&chans[j].PcmSamples[i]), 2);
+			if (!Common::Output->Files())
+			{
+				Common::Write(WavePath, vector<uint8_t>(Output->Data, Output->Data + Output->Length));
+
+				return true;
+			}
+
+			if (Common::Decoded->Fetch(Cached, WavePath))
+			{
+				Common::Produce(WavePath);
+
+				return true;
+			}
+
+			Output.reset();
 		}
 	}
 
+	uint8_t* out = nullptr;
+
+	// An archive has no file to map, so the WAV is built in memory and handed over once it is complete
+	if (Common::Output->Files())
+	{
+		// An output may share its blocks with the cache, or be hard-linked to it by an older build, so it is replaced rather than truncated
+		error_code ec;
+		remove(WavePath, ec);
+
+		Output = make_shared<Mmap>(WavePath.string().c_str(), static_cast<streamoff>(8 + length));
+
+		if (Output->Data == nullptr)
+		{
+			Common::Error(Data, "A writable " + WavePath.filename().string(), 8 + length);
+
+			return false;
+		}
+
+		out = Output->Data;
+	}
+	else
+	{
+		Buffer = make_shared<vector<uint8_t>>(8 + static_cast<size_t>(length));
+
+		out = Buffer->data();
+	}
+
+	Put(out, "RIFF", 4);
+	Put(out, &length, 4);
+	Put(out, "WAVE", 4);
+	Put(out, "fmt ", 4);
+	Put(out, &fmtLength, 4);
+	Put(out, &waveCodec, 2);
+	Put(out, &ChanCount, 2);
+	Put(out, &SampleRate, 4);
+	Put(out, &byteRate, 4);
+	Put(out, &blockAlign, 2);
+	Put(out, &bitsPerSample, 2);
+	Put(out, "data", 4);
+	Put(out, &waveDataLength, 4);
+
+	int16_t* samples = reinterpret_cast<int16_t*>(out);
+
+	for (uint16_t i = 0; i < ChanCount; ++i)
+	{
+		Chans[i].Samples = samples + i;
+		Chans[i].Stride = ChanCount;
+	}
+
+	Pending = samples;
+	Tail = out + waveDataLength;
+
+	return true;
+}
+
+// Completes the WAV once its samples have been decoded and hands it over
+void Cwav::Finish()
+{
+	uint8_t* out = Tail;
+
+	uint32_t smplLength = 60;
+	uint32_t zero = 0;
+	uint32_t sampleLoops = 1;
+
 	if ((SampleMode % 2) != 0)
 	{
-		ofs.write("smpl", 4);
-		ofs.write(reinterpret_cast<const char*>(&smplLength), 4);
+		Put(out, "smpl", 4);
+		Put(out, &smplLength, 4);
 
 		for (uint8_t i = 0; i < 7; ++i)
 		{
-			ofs.write(reinterpret_cast<const char*>(&zero), 4);
+			Put(out, &zero, 4);
 		}
 
-		ofs.write(reinterpret_cast<const char*>(&sampleLoops), 4);
+		Put(out, &sampleLoops, 4);
 
 		for (uint8_t i = 0; i < 3; ++i)
 		{
-			ofs.write(reinterpret_cast<const char*>(&zero), 4);
+			Put(out, &zero, 4);
 		}
 
-		ofs.write(reinterpret_cast<const char*>(&loopStart), 4);
-		ofs.write(reinterpret_cast<const char*>(&loopEnd), 4);
+		Put(out, &LoopStart, 4);
+		Put(out, &LoopEnd, 4);
 
 		for (uint8_t i = 0; i < 2; ++i)
 		{
-			ofs.write(reinterpret_cast<const char*>(&zero), 4);
+			Put(out, &zero, 4);
+		}
+	}
+
+	// An archive copies the WAV out as it goes, rather than taking a second copy of it in memory
+	if (Output == nullptr)
+	{
+		Common::Write(WavePath, Buffer->size(), [this](ostream& out) { out.write(reinterpret_cast<const char*>(Buffer->data()), static_cast<streamsize>(Buffer->size())); });
+	}
+	else
+	{
+		Common::Produce(WavePath);
+	}
+
+	if (!Cached.empty())
+	{
+		if (Output != nullptr)
+		{
+			Common::Decoded->Store(Cached, WavePath);
+		}
+		else
+		{
+			Common::Decoded->Store(Cached, *Buffer);
+		}
+	}
+
+	// An archive has taken its own copy, so rather than keep every wave resident a bank decodes again whatever it needs
+	if (Output == nullptr)
+	{
+		Buffer.reset();
+
+		for (uint16_t i = 0; i < ChanCount; ++i)
+		{
+			Chans[i].Samples = nullptr;
+		}
+	}
+
+	Pending = nullptr;
+}
+
+// The channels from first on are interleaved into samples, each stride apart
+void Cwav::Decode(uint16_t first, uint16_t count, int16_t* samples, uint16_t stride)
+{
+	switch (Codec)
+	{
+		case 0:
+		{
+			uint16_t i = 0;
+
+			// Channels go in pairs where they can, so that a stereo wave is interleaved as it is widened
+			for (; (i + 1) < count; i += 2)
+			{
+				DecodePcm8(Chans[first + i].SampOffset, Chans[first + i + 1u].SampOffset, samples + i, stride, LoopEnd);
+			}
+
+			for (; i < count; ++i)
+			{
+				DecodePcm8(Chans[first + i].SampOffset, samples + i, stride, LoopEnd);
+			}
+
+			break;
+		}
+
+		case 1:
+		{
+			uint16_t i = 0;
+
+			for (; (i + 1) < count; i += 2)
+			{
+				DecodePcm16(Chans[first + i].SampOffset, Chans[first + i + 1u].SampOffset, samples + i, stride, LoopEnd);
+			}
+
+			for (; i < count; ++i)
+			{
+				DecodePcm16(Chans[first + i].SampOffset, samples + i, stride, LoopEnd);
+			}
+
+			break;
+		}
+
+		case 2:
+		{
+			vector<DspStream> streams;
+
+			AddDspStreams(streams, first, count, samples, stride);
+
+			// The channels are independent of each other, so they are decoded side by side
+			DecodeDsp(streams.data(), streams.size());
+
+			break;
 		}
+
+		case 3:
+		{
+			for (uint16_t i = 0; i < count; ++i)
+			{
+				CwavChan& chan = Chans[first + i];
+
+				ImaStream stream{ chan.SampOffset, chan.ImaCntx.Data, chan.ImaCntx.TableIndex, samples + i, stride };
+
+				DecodeIma(stream, LoopEnd);
+			}
+
+			break;
+		}
+	}
+}
+
+// Queues the channels from first on to be decoded by DecodeDsp, possibly alongside the channels of other waves
+void Cwav::AddDspStreams(vector<DspStream>& streams, uint16_t first, uint16_t count, int16_t* samples, uint16_t stride)
+{
+	for (uint16_t i = 0; i < count; ++i)
+	{
+		CwavChan& chan = Chans[first + i];
+
+		streams.push_back({ chan.SampOffset, chan.DspCoeffs, chan.DspCntx.SampHist1, chan.DspCntx.SampHist2, samples + i, stride, LoopEnd });
 	}
+}
 
-	ofs.close();
+bool Cwav::Map(const path& fileName, uint64_t length)
+{
+	shared_ptr<Mmap> wave = make_shared<Mmap>(fileName.string().c_str());
+
+	if ((wave->Data == nullptr) || (static_cast<uint64_t>(wave->Length) != length))
+	{
+		return false;
+	}
+
+	// A finished WAV is laid out exactly like a fresh one, so it serves as the PCM store just the same
+	Output = wave;
+
+	for (uint16_t i = 0; i < ChanCount; ++i)
+	{
+		Chans[i].Samples = reinterpret_cast<int16_t*>(Output->Data + 44) + i;
+		Chans[i].Stride = ChanCount;
+	}
 
 	return true;
 }
+
+// Whatever the channels' samples point into, so that they can be borrowed beyond the life of this CWAV
+shared_ptr<const void> Cwav::Pcm() const
+{
+	if (Output != nullptr)
+	{
+		return Output;
+	}
+
+	return Buffer;
+}
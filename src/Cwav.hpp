@@ -1,7 +1,14 @@
 #pragma once
 
+#include "Common.hpp"
+#include "Dsp.hpp"
+#include "Mmap.hpp"
+
 #include <cstdint>
+#include <filesystem>
 #include <ios>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -12,6 +19,12 @@ struct DspContext
 	int16_t SampHist2;
 };
 
+struct ImaContext
+{
+	int16_t Data;
+	uint8_t TableIndex;
+};
+
 struct CwavChan
 {
 	uint8_t* Offset;
@@ -24,7 +37,10 @@ struct CwavChan
 	DspContext DspCntx;
 	DspContext DspLoopCntx;
 
-	std::vector<int16_t> PcmSamples;
+	ImaContext ImaCntx;
+
+	int16_t* Samples = nullptr;
+	uint16_t Stride = 1;
 };
 
 struct Cwav
@@ -32,10 +48,41 @@ struct Cwav
 	std::string FileName;
 	std::streamoff Length;
 	uint8_t* Data = nullptr;
+	Mmap* File = nullptr;
+	std::shared_ptr<Mmap> Output;
+	std::shared_ptr<std::vector<uint8_t>> Buffer;
+	bool Keep = false;
+
+	std::mutex Mutex;
+	bool Converted = false;
+	bool Result = false;
+	Context Origin;
+	std::filesystem::path OutPath;
 
+	std::filesystem::path WavePath;
+	std::filesystem::path Cached;
+	int16_t* Pending = nullptr;
+	uint8_t* Tail = nullptr;
+
+	uint8_t Codec;
 	uint8_t SampleMode;
+	uint32_t SampleRate;
+	uint32_t LoopStart;
+	uint32_t LoopEnd;
+	uint16_t ChanCount;
+
+	std::vector<CwavChan> Chans;
 
 	Cwav(const char* fileName);
+	Cwav(const char* fileName, uint8_t* data, std::streamoff length);
 	~Cwav();
-	bool Convert();
+	bool Convert(std::filesystem::path outPath);
+	bool Demand();
+	bool Parse(std::filesystem::path outPath);
+	bool Prepare(std::filesystem::path outPath);
+	void Finish();
+	void Decode(uint16_t first, uint16_t count, int16_t* samples, uint16_t stride);
+	void AddDspStreams(std::vector<DspStream>& streams, uint16_t first, uint16_t count, int16_t* samples, uint16_t stride);
+	bool Map(const std::filesystem::path& fileName, uint64_t length);
+	std::shared_ptr<const void> Pcm() const;
 };
@@ -0,0 +1,300 @@
+#include "Dsp.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#ifdef DSP_X86
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET(isa)
+#else
+#define TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+using namespace std;
+
+// Every frame is a predictor/scale header followed by 14 nibbles, high nibble first
+void DecodeDspScalar(DspStream& stream)
+{
+	uint32_t sampleCount = stream.SampleCount;
+	uint8_t* pos = stream.Frames;
+	int32_t hist1 = stream.Hist1;
+	int32_t hist2 = stream.Hist2;
+
+	for (uint32_t i = 0; i < sampleCount; i += 14)
+	{
+		uint8_t header = *pos++;
+		int32_t scale = 1 << (header & 0xF);
+		int32_t coef1 = stream.Coeffs[((header >> 4) & 0x7) * 2];
+		int32_t coef2 = stream.Coeffs[(((header >> 4) & 0x7) * 2) + 1];
+
+		uint32_t frameSamples = min<uint32_t>(14, sampleCount - i);
+
+		for (uint32_t j = 0; j < frameSamples; ++j)
+		{
+			int32_t nibble = (j % 2) == 0 ? static_cast<int8_t>(*pos) >> 4 : static_cast<int8_t>(*pos++ << 4) >> 4;
+			int32_t sample = ((coef1 * hist1) + (coef2 * hist2) + (nibble * scale * 2048) + 1024) >> 11;
+
+			sample = min(max(sample, -32768), 32767);
+
+			stream.Samples[(i + j) * stream.Stride] = static_cast<int16_t>(sample);
+
+			hist2 = hist1;
+			hist1 = sample;
+		}
+	}
+}
+
+#ifdef DSP_X86
+bool HasSse41()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+
+	return (info[2] & (1 << 19)) != 0;
+#else
+	return __builtin_cpu_supports("sse4.1");
+#endif
+}
+
+bool HasAvx2()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+
+	// The OS has to save the YMM registers as well
+	if (((info[2] & (1 << 27)) == 0) || ((info[2] & (1 << 28)) == 0) || ((_xgetbv(0) & 0x6) != 0x6))
+	{
+		return false;
+	}
+
+	__cpuidex(info, 7, 0);
+
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+// Expands one frame of a stream into its coefficients and the scaled nibbles, one column of the lane tables
+static TARGET("sse4.1") void UnpackFrame(const DspStream& stream, uint8_t* frame, size_t lane, size_t lanes, int32_t* coef1, int32_t* coef2, int32_t* distances)
+{
+	uint8_t header = frame[0];
+
+	coef1[lane] = stream.Coeffs[((header >> 4) & 0x7) * 2];
+	coef2[lane] = stream.Coeffs[(((header >> 4) & 0x7) * 2) + 1];
+
+	// Only the 7 bytes of this frame are read, so the last one may end the mapping
+	uint64_t bytes = 0;
+	memcpy(&bytes, frame + 1, 7);
+
+	__m128i packed = _mm_cvtepi8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(&bytes)));
+	__m128i high = _mm_srai_epi16(packed, 4);
+	__m128i low = _mm_srai_epi16(_mm_slli_epi16(packed, 12), 12);
+
+	__m128i nibbles[2] = { _mm_unpacklo_epi16(high, low), _mm_unpackhi_epi16(high, low) };
+	__m128i scale = _mm_set1_epi32(1 << ((header & 0xF) + 11));
+
+	alignas(16) int32_t scaled[16];
+
+	for (size_t i = 0; i < 2; ++i)
+	{
+		_mm_store_si128(reinterpret_cast<__m128i*>(scaled) + (i * 2), _mm_mullo_epi32(_mm_cvtepi16_epi32(nibbles[i]), scale));
+		_mm_store_si128(reinterpret_cast<__m128i*>(scaled) + (i * 2) + 1, _mm_mullo_epi32(_mm_cvtepi16_epi32(_mm_srli_si128(nibbles[i], 8)), scale));
+	}
+
+	for (size_t i = 0; i < 14; ++i)
+	{
+		distances[(i * lanes) + lane] = scaled[i];
+	}
+}
+
+// Decodes up to 4 streams side by side, one stream per lane, until the longest of them ends
+TARGET("sse4.1") void DecodeDspSse41(DspStream* streams, size_t count)
+{
+	uint32_t sampleCount = 0;
+
+	alignas(16) int32_t coef1[4] = {};
+	alignas(16) int32_t coef2[4] = {};
+	alignas(16) int32_t distances[14 * 4] = {};
+	alignas(16) int32_t samples[14 * 4];
+	alignas(16) int32_t hist[2][4] = {};
+
+	for (size_t lane = 0; lane < count; ++lane)
+	{
+		hist[0][lane] = streams[lane].Hist1;
+		hist[1][lane] = streams[lane].Hist2;
+
+		sampleCount = max(sampleCount, streams[lane].SampleCount);
+	}
+
+	__m128i hist1 = _mm_load_si128(reinterpret_cast<const __m128i*>(hist[0]));
+	__m128i hist2 = _mm_load_si128(reinterpret_cast<const __m128i*>(hist[1]));
+	__m128i round = _mm_set1_epi32(1024);
+	__m128i lowest = _mm_set1_epi32(-32768);
+	__m128i highest = _mm_set1_epi32(32767);
+
+	for (uint32_t i = 0; i < sampleCount; i += 14)
+	{
+		// A lane whose stream has ended keeps running on its last frame, but nothing more is read or stored for it
+		for (size_t lane = 0; lane < count; ++lane)
+		{
+			if (i < streams[lane].SampleCount)
+			{
+				UnpackFrame(streams[lane], streams[lane].Frames + ((i / 14) * 8), lane, 4, coef1, coef2, distances);
+			}
+		}
+
+		__m128i c1 = _mm_load_si128(reinterpret_cast<const __m128i*>(coef1));
+		__m128i c2 = _mm_load_si128(reinterpret_cast<const __m128i*>(coef2));
+
+		uint32_t frameSamples = min<uint32_t>(14, sampleCount - i);
+
+		for (uint32_t j = 0; j < frameSamples; ++j)
+		{
+			__m128i predicted = _mm_add_epi32(_mm_mullo_epi32(c1, hist1), _mm_mullo_epi32(c2, hist2));
+			__m128i distance = _mm_load_si128(reinterpret_cast<const __m128i*>(distances + (j * 4)));
+			__m128i sample = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(predicted, distance), round), 11);
+
+			sample = _mm_min_epi32(_mm_max_epi32(sample, lowest), highest);
+
+			_mm_store_si128(reinterpret_cast<__m128i*>(samples + (j * 4)), sample);
+
+			hist2 = hist1;
+			hist1 = sample;
+		}
+
+		for (size_t lane = 0; lane < count; ++lane)
+		{
+			uint32_t laneSamples = i < streams[lane].SampleCount ? min<uint32_t>(14, streams[lane].SampleCount - i) : 0;
+
+			for (uint32_t j = 0; j < laneSamples; ++j)
+			{
+				streams[lane].Samples[(i + j) * streams[lane].Stride] = static_cast<int16_t>(samples[(j * 4) + lane]);
+			}
+		}
+	}
+}
+
+// Decodes up to 8 streams side by side, one stream per lane, until the longest of them ends
+TARGET("avx2") void DecodeDspAvx2(DspStream* streams, size_t count)
+{
+	uint32_t sampleCount = 0;
+
+	alignas(32) int32_t coef1[8] = {};
+	alignas(32) int32_t coef2[8] = {};
+	alignas(32) int32_t distances[14 * 8] = {};
+	alignas(32) int32_t samples[14 * 8];
+	alignas(32) int32_t hist[2][8] = {};
+
+	for (size_t lane = 0; lane < count; ++lane)
+	{
+		hist[0][lane] = streams[lane].Hist1;
+		hist[1][lane] = streams[lane].Hist2;
+
+		sampleCount = max(sampleCount, streams[lane].SampleCount);
+	}
+
+	__m256i hist1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(hist[0]));
+	__m256i hist2 = _mm256_load_si256(reinterpret_cast<const __m256i*>(hist[1]));
+	__m256i round = _mm256_set1_epi32(1024);
+	__m256i lowest = _mm256_set1_epi32(-32768);
+	__m256i highest = _mm256_set1_epi32(32767);
+
+	for (uint32_t i = 0; i < sampleCount; i += 14)
+	{
+		// A lane whose stream has ended keeps running on its last frame, but nothing more is read or stored for it
+		for (size_t lane = 0; lane < count; ++lane)
+		{
+			if (i < streams[lane].SampleCount)
+			{
+				UnpackFrame(streams[lane], streams[lane].Frames + ((i / 14) * 8), lane, 8, coef1, coef2, distances);
+			}
+		}
+
+		__m256i c1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(coef1));
+		__m256i c2 = _mm256_load_si256(reinterpret_cast<const __m256i*>(coef2));
+
+		uint32_t frameSamples = min<uint32_t>(14, sampleCount - i);
+
+		for (uint32_t j = 0; j < frameSamples; ++j)
+		{
+			__m256i predicted = _mm256_add_epi32(_mm256_mullo_epi32(c1, hist1), _mm256_mullo_epi32(c2, hist2));
+			__m256i distance = _mm256_load_si256(reinterpret_cast<const __m256i*>(distances + (j * 8)));
+			__m256i sample = _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(predicted, distance), round), 11);
+
+			sample = _mm256_min_epi32(_mm256_max_epi32(sample, lowest), highest);
+
+			_mm256_store_si256(reinterpret_cast<__m256i*>(samples + (j * 8)), sample);
+
+			hist2 = hist1;
+			hist1 = sample;
+		}
+
+		for (size_t lane = 0; lane < count; ++lane)
+		{
+			uint32_t laneSamples = i < streams[lane].SampleCount ? min<uint32_t>(14, streams[lane].SampleCount - i) : 0;
+
+			for (uint32_t j = 0; j < laneSamples; ++j)
+			{
+				streams[lane].Samples[(i + j) * streams[lane].Stride] = static_cast<int16_t>(samples[(j * 8) + lane]);
+			}
+		}
+	}
+}
+#endif
+
+void DecodeDsp(DspStream* streams, size_t count)
+{
+	size_t i = 0;
+
+	// Streams of similar length share lanes, so that few lanes idle while the longest one finishes
+	vector<DspStream> sorted(streams, streams + count);
+
+	stable_sort(sorted.begin(), sorted.end(), [](const DspStream& a, const DspStream& b) { return a.SampleCount > b.SampleCount; });
+
+	streams = sorted.data();
+
+#ifdef DSP_X86
+	static const bool sse41 = HasSse41();
+	static const bool avx2 = HasAvx2();
+
+	// A single stream is serial from start to end, so lanes only pay off with two or more
+	while ((count - i) >= 2)
+	{
+		if (avx2 && ((count - i) > 4))
+		{
+			size_t lanes = min<size_t>(8, count - i);
+
+			DecodeDspAvx2(streams + i, lanes);
+
+			i += lanes;
+		}
+		else if (sse41)
+		{
+			size_t lanes = min<size_t>(4, count - i);
+
+			DecodeDspSse41(streams + i, lanes);
+
+			i += lanes;
+		}
+		else
+		{
+			break;
+		}
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		DecodeDspScalar(streams[i]);
+	}
+}
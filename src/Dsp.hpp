@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define DSP_X86
+#endif
+
+struct DspStream
+{
+	uint8_t* Frames;
+	const int16_t* Coeffs;
+	int16_t Hist1;
+	int16_t Hist2;
+
+	int16_t* Samples;
+	size_t Stride;
+	uint32_t SampleCount;
+};
+
+void DecodeDsp(DspStream* streams, size_t count);
+void DecodeDspScalar(DspStream& stream);
+
+// The kernels decode at most 4 and 8 streams side by side, and are only safe to call where the CPU supports them
+#ifdef DSP_X86
+bool HasSse41();
+bool HasAvx2();
+void DecodeDspSse41(DspStream* streams, size_t count);
+void DecodeDspAvx2(DspStream* streams, size_t count);
+#endif
@@ -0,0 +1,106 @@
+#include "Hash.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+// XXH64, which hashes several gigabytes a second and is well enough distributed to key a cache by
+const uint64_t Prime1 = 0x9E3779B185EBCA87;
+const uint64_t Prime2 = 0xC2B2AE3D27D4EB4F;
+const uint64_t Prime3 = 0x165667B19E3779F9;
+const uint64_t Prime4 = 0x85EBCA77C2B2AE63;
+const uint64_t Prime5 = 0x27D4EB2F165667C5;
+
+namespace
+{
+	uint64_t Rotate(uint64_t value, int bits)
+	{
+		return (value << bits) | (value >> (64 - bits));
+	}
+
+	uint64_t Load64(const uint8_t* data)
+	{
+		uint64_t value = 0;
+
+		for (int i = 0; i < 8; ++i)
+		{
+			value |= static_cast<uint64_t>(data[i]) << (i * 8);
+		}
+
+		return value;
+	}
+
+	uint32_t Load32(const uint8_t* data)
+	{
+		return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) | (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+	}
+
+	uint64_t Round(uint64_t acc, uint64_t input)
+	{
+		return Rotate(acc + (input * Prime2), 31) * Prime1;
+	}
+
+	uint64_t Merge(uint64_t acc, uint64_t value)
+	{
+		return ((acc ^ Round(0, value)) * Prime1) + Prime4;
+	}
+}
+
+uint64_t Hash64(const uint8_t* data, size_t length, uint64_t seed)
+{
+	const uint8_t* end = data + length;
+	uint64_t hash;
+
+	if (length >= 32)
+	{
+		uint64_t v1 = seed + Prime1 + Prime2;
+		uint64_t v2 = seed + Prime2;
+		uint64_t v3 = seed;
+		uint64_t v4 = seed - Prime1;
+
+		for (; (end - data) >= 32; data += 32)
+		{
+			v1 = Round(v1, Load64(data));
+			v2 = Round(v2, Load64(data + 8));
+			v3 = Round(v3, Load64(data + 16));
+			v4 = Round(v4, Load64(data + 24));
+		}
+
+		hash = Rotate(v1, 1) + Rotate(v2, 7) + Rotate(v3, 12) + Rotate(v4, 18);
+		hash = Merge(hash, v1);
+		hash = Merge(hash, v2);
+		hash = Merge(hash, v3);
+		hash = Merge(hash, v4);
+	}
+	else
+	{
+		hash = seed + Prime5;
+	}
+
+	hash += length;
+
+	for (; (end - data) >= 8; data += 8)
+	{
+		hash = (Rotate(hash ^ Round(0, Load64(data)), 27) * Prime1) + Prime4;
+	}
+
+	if ((end - data) >= 4)
+	{
+		hash = (Rotate(hash ^ (Load32(data) * Prime1), 23) * Prime2) + Prime3;
+		data += 4;
+	}
+
+	for (; data < end; ++data)
+	{
+		hash = Rotate(hash ^ (*data * Prime5), 11) * Prime1;
+	}
+
+	hash ^= hash >> 33;
+	hash *= Prime2;
+	hash ^= hash >> 29;
+	hash *= Prime3;
+	hash ^= hash >> 32;
+
+	return hash;
+}
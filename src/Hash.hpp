@@ -0,0 +1,6 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+uint64_t Hash64(const uint8_t* data, size_t length, uint64_t seed = 0);
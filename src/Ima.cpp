@@ -0,0 +1,52 @@
+#include "Ima.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+using namespace std;
+
+const int32_t StepTable[] = { 7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767 };
+const int8_t IndexTable[] = { -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8 };
+
+// Every step index and nibble pair resolves to a difference (in eighths of a sample) and the next step index
+// This is the 3DS expansion, as in vgmstream's n3ds_ima_expand_nibble: hist * 8 + step * (2n + 1), shifted down by 3
+// The standard IMA expansion sums step >> 3, step >> 2, step >> 1 and step, each truncated on its own, so the two differ for small steps (step 7 with nibble 1 gives 2 here and 1 there)
+struct ImaTables
+{
+	int32_t Diffs[89][16];
+	uint8_t Indices[89][16];
+
+	ImaTables()
+	{
+		for (int32_t i = 0; i < 89; ++i)
+		{
+			for (int32_t j = 0; j < 16; ++j)
+			{
+				int32_t diff = StepTable[i] * (((j & 0x7) * 2) + 1);
+
+				Diffs[i][j] = (j & 0x8) != 0 ? -diff : diff;
+				Indices[i][j] = static_cast<uint8_t>(min(max(i + IndexTable[j], 0), 88));
+			}
+		}
+	}
+};
+
+const ImaTables Tables;
+
+void DecodeIma(ImaStream& stream, uint32_t sampleCount)
+{
+	uint8_t* pos = stream.Data;
+	int32_t hist = stream.Hist;
+	uint8_t index = min<uint8_t>(stream.Index, 88);
+
+	// Low nibble first
+	for (uint32_t i = 0; i < sampleCount; ++i)
+	{
+		uint8_t nibble = (i % 2) == 0 ? (*pos & 0xF) : (*pos++ >> 4);
+
+		hist = min(max(((hist * 8) + Tables.Diffs[index][nibble]) >> 3, -32768), 32767);
+		index = Tables.Indices[index][nibble];
+
+		stream.Samples[i * stream.Stride] = static_cast<int16_t>(hist);
+	}
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+struct ImaStream
+{
+	uint8_t* Data;
+	int16_t Hist;
+	uint8_t Index;
+
+	int16_t* Samples;
+	size_t Stride;
+};
+
+void DecodeIma(ImaStream& stream, uint32_t sampleCount);
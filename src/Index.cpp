@@ -0,0 +1,34 @@
+#include "Index.hpp"
+#include "Cwar.hpp"
+
+#include <cstdint>
+
+using namespace std;
+
+Index::~Index()
+{
+	for (auto cwar : Cwars)
+	{
+		delete cwar;
+	}
+}
+
+Cwar* Index::FindCwar(uint32_t index) const
+{
+	return index < Cwars.size() ? Cwars[index] : nullptr;
+}
+
+uint32_t Index::FindFileCwar(uint32_t fileId) const
+{
+	return fileId < FileCwars.size() ? FileCwars[fileId] : None;
+}
+
+uint32_t Index::FindFileCbnk(uint32_t fileId) const
+{
+	return fileId < FileCbnks.size() ? FileCbnks[fileId] : None;
+}
+
+bool Index::IsFileCseq(uint32_t fileId) const
+{
+	return (fileId < FileCseqs.size()) && FileCseqs[fileId];
+}
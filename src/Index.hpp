@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Cwar.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct CsarFile
+{
+	uint8_t* Offset;
+	uint32_t Length;
+
+	std::string Location = "";
+};
+
+struct CsarCbnk
+{
+	uint8_t* Offset;
+
+	uint32_t Id;
+	std::string FileName;
+};
+
+struct CsarCseq
+{
+	uint8_t* Offset;
+
+	std::string FileName;
+};
+
+struct CsarCgrp
+{
+	uint8_t* Offset;
+
+	uint32_t Id;
+	std::string FileName;
+};
+
+// Everything in a CSAR that is referred to by number, each table addressed directly by that number
+struct Index
+{
+	static constexpr uint32_t None = 0xFFFFFFFF;
+
+	std::vector<CsarFile> Files;
+	std::vector<Cwar*> Cwars;
+	std::vector<CsarCbnk> Cbnks;
+	std::vector<CsarCseq> Cseqs;
+	std::vector<CsarCgrp> Cgrps;
+
+	std::vector<uint32_t> FileCwars;
+	std::vector<uint32_t> FileCbnks;
+	std::vector<bool> FileCseqs;
+
+	~Index();
+	Cwar* FindCwar(uint32_t index) const;
+	uint32_t FindFileCwar(uint32_t fileId) const;
+	uint32_t FindFileCbnk(uint32_t fileId) const;
+	bool IsFileCseq(uint32_t fileId) const;
+};
@@ -0,0 +1,26 @@
+#include "Library.hpp"
+#include "Common.hpp"
+
+#include <sf2cute.hpp>
+
+#include <filesystem>
+#include <ostream>
+#include <string>
+
+using namespace std;
+using namespace filesystem;
+using namespace sf2cute;
+
+Library::Library(const string& name)
+{
+	Sf2.set_sound_engine("EMU8000");
+	Sf2.set_bank_name(name);
+	Sf2.set_rom_name("ROM");
+	Sf2.set_software("Caesar");
+}
+
+void Library::Save(const path& fileName)
+{
+	// The samples are only produced as they are written, so the SF2 goes out as a stream rather than a buffer
+	Common::Write(fileName, Sf2.GetFileSize(), [this](ostream& out) { Sf2.Write(out); });
+}
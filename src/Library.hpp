@@ -0,0 +1,29 @@
+#pragma once
+
+#include <sf2cute.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+struct LibrarySample
+{
+	std::shared_ptr<sf2cute::SFSample> Left;
+	std::shared_ptr<sf2cute::SFSample> Right;
+};
+
+struct Library
+{
+	std::mutex Mutex;
+	sf2cute::SoundFont Sf2;
+
+	std::map<std::pair<uint32_t, uint32_t>, LibrarySample> Waves;
+	std::map<uint64_t, LibrarySample> Contents;
+
+	Library(const std::string& name);
+	void Save(const std::filesystem::path& fileName);
+};
@@ -0,0 +1,163 @@
+#include "Manifest.hpp"
+#include "Common.hpp"
+#include "Hash.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+using namespace std;
+using namespace filesystem;
+
+// Bumped whenever the outputs of an unchanged sub-file would change, so that a newer build never keeps what an older one wrote
+const int ManifestVersion = 1;
+
+Manifest::Manifest(path fileName, path root, string settings, bool enabled) : FileName(fileName), Root(root), Enabled(enabled)
+{
+	Settings = "caesar manifest\t" + to_string(ManifestVersion) + "\t" + settings;
+
+	if (!Enabled)
+	{
+		return;
+	}
+
+	ifstream ifs(FileName);
+
+	string line;
+
+	if (!getline(ifs, line) || (line != Settings))
+	{
+		return;
+	}
+
+	ManifestEntry* entry = nullptr;
+
+	while (getline(ifs, line))
+	{
+		if (line.empty())
+		{
+			continue;
+		}
+
+		if (line[0] == '\t')
+		{
+			if (entry != nullptr)
+			{
+				entry->Produced.Files.push_back(line.substr(1));
+			}
+
+			continue;
+		}
+
+		istringstream iss(line);
+
+		string name;
+		string offset;
+		string length;
+		string hash;
+
+		if (!getline(iss, name, '\t') || !getline(iss, offset, '\t') || !getline(iss, length, '\t') || !getline(iss, hash, '\t'))
+		{
+			entry = nullptr;
+
+			continue;
+		}
+
+		entry = &Previous[name];
+		entry->Offset = strtoull(offset.c_str(), nullptr, 10);
+		entry->Length = strtoull(length.c_str(), nullptr, 10);
+		entry->Hash = strtoull(hash.c_str(), nullptr, 16);
+	}
+
+	ifs.close();
+
+	// Until this run completes, its outputs no longer match any manifest
+	error_code ec;
+	remove(FileName, ec);
+}
+
+ManifestEntry* Manifest::Track(const string& name, uint8_t* base, uint8_t* data, uint64_t length, uint64_t seed)
+{
+	ManifestEntry& entry = Entries[name];
+
+	// A length taken from a damaged header must not reach past the file it is embedded in
+	length = min<uint64_t>(length, static_cast<uint64_t>(max<ptrdiff_t>(Common::Remaining(data), 0)));
+
+	entry.Offset = static_cast<uint64_t>(data - base);
+	entry.Length = length;
+
+	if (!Enabled)
+	{
+		return &entry;
+	}
+
+	entry.Hash = Hash64(data, length, seed);
+
+	auto it = Previous.find(name);
+
+	if ((it == Previous.end()) || (it->second.Length != entry.Length) || (it->second.Hash != entry.Hash))
+	{
+		return &entry;
+	}
+
+	for (const string& file : it->second.Produced.Files)
+	{
+		if (!exists(Root / file))
+		{
+			return &entry;
+		}
+	}
+
+	entry.Unchanged = true;
+
+	for (const string& file : it->second.Produced.Files)
+	{
+		entry.Produced.Files.push_back((Root / file).string());
+	}
+
+	return &entry;
+}
+
+void Manifest::Save()
+{
+	if (!Enabled)
+	{
+		return;
+	}
+
+	ostringstream oss;
+
+	oss << Settings << endl;
+
+	for (auto& entry : Entries)
+	{
+		char hash[17];
+		snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(entry.second.Hash));
+
+		oss << entry.first << "\t" << entry.second.Offset << "\t" << entry.second.Length << "\t" << hash << endl;
+
+		vector<string>& files = entry.second.Produced.Files;
+
+		sort(files.begin(), files.end());
+
+		for (const string& file : files)
+		{
+			path relative = path(file).lexically_relative(Root);
+
+			oss << "\t" << (relative.empty() ? path(file) : relative).generic_string() << endl;
+		}
+	}
+
+	string manifest = oss.str();
+
+	Common::Write(FileName, vector<uint8_t>(manifest.begin(), manifest.end()));
+}
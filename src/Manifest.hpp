@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Common.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+
+struct ManifestEntry
+{
+	uint64_t Offset = 0;
+	uint64_t Length = 0;
+	uint64_t Hash = 0;
+	bool Unchanged = false;
+
+	Outputs Produced;
+};
+
+struct Manifest
+{
+	std::filesystem::path FileName;
+	std::filesystem::path Root;
+	std::string Settings;
+	bool Enabled;
+
+	std::map<std::string, ManifestEntry> Previous;
+	std::map<std::string, ManifestEntry> Entries;
+
+	Manifest(std::filesystem::path fileName, std::filesystem::path root, std::string settings, bool enabled);
+	ManifestEntry* Track(const std::string& name, uint8_t* base, uint8_t* data, uint64_t length, uint64_t seed = 0);
+	void Save();
+};
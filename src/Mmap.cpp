@@ -0,0 +1,154 @@
+#include "Mmap.hpp"
+
+#include <cstdint>
+#include <ios>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+#ifdef _WIN32
+Mmap::Mmap(const char* fileName) : FileName(fileName)
+{
+	File = CreateFileA(FileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+	if (File == INVALID_HANDLE_VALUE)
+	{
+		File = nullptr;
+
+		return;
+	}
+
+	LARGE_INTEGER size;
+
+	if (!GetFileSizeEx(File, &size) || (size.QuadPart == 0))
+	{
+		return;
+	}
+
+	Mapping = CreateFileMappingA(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	if (Mapping == nullptr)
+	{
+		return;
+	}
+
+	Data = static_cast<uint8_t*>(MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0));
+
+	if (Data != nullptr)
+	{
+		Length = size.QuadPart;
+	}
+}
+
+Mmap::Mmap(const char* fileName, streamoff length) : FileName(fileName)
+{
+	File = CreateFileA(FileName.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if (File == INVALID_HANDLE_VALUE)
+	{
+		File = nullptr;
+
+		return;
+	}
+
+	LARGE_INTEGER size;
+	size.QuadPart = length;
+
+	Mapping = CreateFileMappingA(File, nullptr, PAGE_READWRITE, size.HighPart, size.LowPart, nullptr);
+
+	if (Mapping == nullptr)
+	{
+		return;
+	}
+
+	Data = static_cast<uint8_t*>(MapViewOfFile(Mapping, FILE_MAP_WRITE, 0, 0, 0));
+
+	if (Data != nullptr)
+	{
+		Length = length;
+	}
+}
+
+Mmap::~Mmap()
+{
+	if (Data != nullptr)
+	{
+		UnmapViewOfFile(Data);
+	}
+
+	if (Mapping != nullptr)
+	{
+		CloseHandle(Mapping);
+	}
+
+	if (File != nullptr)
+	{
+		CloseHandle(File);
+	}
+}
+#else
+Mmap::Mmap(const char* fileName) : FileName(fileName)
+{
+	int fd = open(FileName.c_str(), O_RDONLY);
+
+	if (fd == -1)
+	{
+		return;
+	}
+
+	struct stat st;
+
+	if ((fstat(fd, &st) == 0) && (st.st_size > 0))
+	{
+		void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+		if (data != MAP_FAILED)
+		{
+			Data = static_cast<uint8_t*>(data);
+			Length = st.st_size;
+		}
+	}
+
+	close(fd);
+}
+
+Mmap::Mmap(const char* fileName, streamoff length) : FileName(fileName)
+{
+	int fd = open(FileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+	if (fd == -1)
+	{
+		return;
+	}
+
+	if ((length > 0) && (ftruncate(fd, length) == 0))
+	{
+		void* data = mmap(nullptr, static_cast<size_t>(length), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+		if (data != MAP_FAILED)
+		{
+			Data = static_cast<uint8_t*>(data);
+			Length = length;
+		}
+	}
+
+	close(fd);
+}
+
+Mmap::~Mmap()
+{
+	if (Data != nullptr)
+	{
+		munmap(Data, static_cast<size_t>(Length));
+	}
+}
+#endif
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <ios>
+#include <string>
+
+struct Mmap
+{
+	std::string FileName;
+	std::streamoff Length = 0;
+	uint8_t* Data = nullptr;
+
+#ifdef _WIN32
+	void* File = nullptr;
+	void* Mapping = nullptr;
+#endif
+
+	Mmap(const char* fileName);
+	Mmap(const char* fileName, std::streamoff length);
+	Mmap(const Mmap&) = delete;
+	Mmap& operator=(const Mmap&) = delete;
+	~Mmap();
+};
@@ -0,0 +1,106 @@
+#include "Pcm.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define PCM_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+// Samples are signed, so widening is just moving each byte into the high half
+void DecodePcm8(uint8_t* data, int16_t* samples, size_t stride, uint32_t sampleCount)
+{
+	uint32_t i = 0;
+
+#ifdef PCM_SSE2
+	__m128i zero = _mm_setzero_si128();
+
+	for (; (stride == 1) && ((i + 16) <= sampleCount); i += 16)
+	{
+		__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(samples + i), _mm_unpacklo_epi8(zero, bytes));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(samples + i + 8), _mm_unpackhi_epi8(zero, bytes));
+	}
+#endif
+
+	for (; i < sampleCount; ++i)
+	{
+		samples[i * stride] = static_cast<int16_t>(data[i] << 8);
+	}
+}
+
+// A stereo pair is widened a channel at a time and then interleaved sample by sample
+void DecodePcm8(uint8_t* left, uint8_t* right, int16_t* samples, size_t stride, uint32_t sampleCount)
+{
+	uint32_t i = 0;
+
+#ifdef PCM_SSE2
+	__m128i zero = _mm_setzero_si128();
+
+	for (; (stride == 2) && ((i + 16) <= sampleCount); i += 16)
+	{
+		__m128i leftBytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(left + i));
+		__m128i rightBytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(right + i));
+
+		__m128i leftLow = _mm_unpacklo_epi8(zero, leftBytes);
+		__m128i leftHigh = _mm_unpackhi_epi8(zero, leftBytes);
+		__m128i rightLow = _mm_unpacklo_epi8(zero, rightBytes);
+		__m128i rightHigh = _mm_unpackhi_epi8(zero, rightBytes);
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(samples + (i * 2)), _mm_unpacklo_epi16(leftLow, rightLow));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(samples + (i * 2) + 8), _mm_unpackhi_epi16(leftLow, rightLow));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(samples + (i * 2) + 16), _mm_unpacklo_epi16(leftHigh, rightHigh));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(samples + (i * 2) + 24), _mm_unpackhi_epi16(leftHigh, rightHigh));
+	}
+#endif
+
+	for (; i < sampleCount; ++i)
+	{
+		samples[i * stride] = static_cast<int16_t>(left[i] << 8);
+		samples[(i * stride) + 1] = static_cast<int16_t>(right[i] << 8);
+	}
+}
+
+void DecodePcm16(uint8_t* data, int16_t* samples, size_t stride, uint32_t sampleCount)
+{
+#if !defined(__BYTE_ORDER__) || (__BYTE_ORDER__ != __ORDER_BIG_ENDIAN__)
+	if (stride == 1)
+	{
+		memcpy(samples, data, sampleCount * sizeof(int16_t));
+
+		return;
+	}
+#endif
+
+	for (uint32_t i = 0; i < sampleCount; ++i)
+	{
+		samples[i * stride] = static_cast<int16_t>(data[i * 2] | (data[(i * 2) + 1] << 8));
+	}
+}
+
+void DecodePcm16(uint8_t* left, uint8_t* right, int16_t* samples, size_t stride, uint32_t sampleCount)
+{
+	uint32_t i = 0;
+
+#ifdef PCM_SSE2
+	for (; (stride == 2) && ((i + 8) <= sampleCount); i += 8)
+	{
+		__m128i leftWords = _mm_loadu_si128(reinterpret_cast<const __m128i*>(left + (i * 2)));
+		__m128i rightWords = _mm_loadu_si128(reinterpret_cast<const __m128i*>(right + (i * 2)));
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(samples + (i * 2)), _mm_unpacklo_epi16(leftWords, rightWords));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(samples + (i * 2) + 8), _mm_unpackhi_epi16(leftWords, rightWords));
+	}
+#endif
+
+	for (; i < sampleCount; ++i)
+	{
+		samples[i * stride] = static_cast<int16_t>(left[i * 2] | (left[(i * 2) + 1] << 8));
+		samples[(i * stride) + 1] = static_cast<int16_t>(right[i * 2] | (right[(i * 2) + 1] << 8));
+	}
+}
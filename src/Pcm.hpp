@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+void DecodePcm8(uint8_t* data, int16_t* samples, size_t stride, uint32_t sampleCount);
+void DecodePcm8(uint8_t* left, uint8_t* right, int16_t* samples, size_t stride, uint32_t sampleCount);
+void DecodePcm16(uint8_t* data, int16_t* samples, size_t stride, uint32_t sampleCount);
+void DecodePcm16(uint8_t* left, uint8_t* right, int16_t* samples, size_t stride, uint32_t sampleCount);
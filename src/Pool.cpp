@@ -0,0 +1,206 @@
+#include "Pool.hpp"
+#include "Common.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+Pool::Pool(unsigned threadCount)
+{
+	// The thread that waits on a batch of tasks helps to run them, so it counts as one of the threads
+	for (unsigned i = 1; i < threadCount; ++i)
+	{
+		Threads.emplace_back(&Pool::Work, this);
+	}
+}
+
+Pool::~Pool()
+{
+	{
+		lock_guard<mutex> lock(Mutex);
+
+		Stopping = true;
+	}
+
+	Ready.notify_all();
+
+	for (auto& thread : Threads)
+	{
+		thread.join();
+	}
+}
+
+void Pool::Submit(function<void()> task, Tasks* owner)
+{
+	{
+		lock_guard<mutex> lock(Mutex);
+
+		Queue.push_back(PoolTask{ owner, move(task) });
+	}
+
+	Ready.notify_all();
+}
+
+void Pool::Work()
+{
+	unique_lock<mutex> lock(Mutex);
+
+	while (true)
+	{
+		Ready.wait(lock, [this] { return Stopping || !Queue.empty(); });
+
+		if (Queue.empty())
+		{
+			return;
+		}
+
+		function<void()> task = move(Queue.front().Task);
+		Queue.pop_front();
+
+		lock.unlock();
+		task();
+		lock.lock();
+	}
+}
+
+Tasks::Tasks(Pool* workers) : Workers(workers != nullptr && !workers->Threads.empty() ? workers : nullptr)
+{
+}
+
+Tasks::~Tasks()
+{
+	Wait();
+
+	for (auto job : Jobs)
+	{
+		delete job;
+	}
+}
+
+Job* Tasks::Run(function<bool()> task, const vector<Job*>& dependencies)
+{
+	Job* job = new Job;
+	job->Task = move(task);
+
+	Jobs.push_back(job);
+
+	// Inline, every dependency has already run by the time its dependents are added
+	if (Workers == nullptr)
+	{
+		for (auto dependency : dependencies)
+		{
+			job->Result = dependency->Result && job->Result;
+		}
+
+		job->Result = job->Result && job->Task();
+		job->Done = true;
+
+		Result = job->Result && Result;
+
+		return job;
+	}
+
+	job->Current = Common::Current;
+
+	{
+		lock_guard<mutex> lock(Workers->Mutex);
+
+		for (auto dependency : dependencies)
+		{
+			if (!dependency->Done)
+			{
+				++job->Waiting;
+
+				dependency->Dependents.push_back(job);
+			}
+			else
+			{
+				job->Result = dependency->Result && job->Result;
+			}
+		}
+
+		++Pending;
+
+		if (job->Waiting == 0)
+		{
+			Workers->Queue.push_back(PoolTask{ this, [this, job] { Execute(job); } });
+		}
+	}
+
+	Workers->Ready.notify_all();
+
+	return job;
+}
+
+void Tasks::Execute(Job* job)
+{
+	// Once Pending drops to zero the waiter may destroy this group, so the pool is notified through a copy of its pointer
+	Pool* workers = Workers;
+
+	Context saved = move(Common::Current);
+	Common::Current = job->Current;
+
+	// A job whose dependency failed is skipped and fails in turn
+	bool result = job->Result && job->Task();
+
+	Common::Current = move(saved);
+
+	{
+		lock_guard<mutex> lock(workers->Mutex);
+
+		job->Done = true;
+		job->Result = result;
+
+		for (auto dependent : job->Dependents)
+		{
+			dependent->Result = result && dependent->Result;
+
+			if (--dependent->Waiting == 0)
+			{
+				workers->Queue.push_back(PoolTask{ this, [this, dependent] { Execute(dependent); } });
+			}
+		}
+
+		Result = result && Result;
+		--Pending;
+	}
+
+	workers->Ready.notify_all();
+}
+
+bool Tasks::Wait()
+{
+	if (Workers == nullptr)
+	{
+		return Result;
+	}
+
+	unique_lock<mutex> lock(Workers->Mutex);
+
+	while (Pending != 0)
+	{
+		// Only this group's own jobs are run here, so a wait never ends up behind unrelated work and only nests as deep as the groups do
+		auto next = find_if(Workers->Queue.begin(), Workers->Queue.end(), [this](const PoolTask& task) { return task.Owner == this; });
+
+		if (next == Workers->Queue.end())
+		{
+			Workers->Ready.wait(lock);
+
+			continue;
+		}
+
+		function<void()> task = move(next->Task);
+		Workers->Queue.erase(next);
+
+		lock.unlock();
+		task();
+		lock.lock();
+	}
+
+	return Result;
+}
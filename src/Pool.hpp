@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Common.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct Tasks;
+
+struct PoolTask
+{
+	Tasks* Owner;
+	std::function<void()> Task;
+};
+
+struct Pool
+{
+	std::vector<std::thread> Threads;
+	std::deque<PoolTask> Queue;
+	std::mutex Mutex;
+	std::condition_variable Ready;
+	bool Stopping = false;
+
+	Pool(unsigned threadCount);
+	~Pool();
+	void Submit(std::function<void()> task, Tasks* owner = nullptr);
+	void Work();
+};
+
+struct Job
+{
+	std::function<bool()> Task;
+	Context Current;
+
+	size_t Waiting = 0;
+	std::vector<Job*> Dependents;
+
+	bool Done = false;
+	bool Result = true;
+};
+
+struct Tasks
+{
+	Pool* Workers;
+	std::vector<Job*> Jobs;
+	size_t Pending = 0;
+	bool Result = true;
+
+	Tasks(Pool* workers);
+	~Tasks();
+	Job* Run(std::function<bool()> task, const std::vector<Job*>& dependencies = {});
+	void Execute(Job* job);
+	bool Wait();
+};
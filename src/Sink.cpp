@@ -0,0 +1,979 @@
+#include "Sink.hpp"
+#include "Common.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <ostream>
+#include <set>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#ifdef __linux__
+#include <cerrno>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace filesystem;
+
+namespace
+{
+	struct Crc32
+	{
+		uint32_t Table[256];
+
+		Crc32()
+		{
+			for (uint32_t i = 0; i < 256; ++i)
+			{
+				uint32_t crc = i;
+
+				for (uint8_t j = 0; j < 8; ++j)
+				{
+					crc = ((crc & 1) != 0) ? ((crc >> 1) ^ 0xEDB88320) : (crc >> 1);
+				}
+
+				Table[i] = crc;
+			}
+		}
+
+		uint32_t Compute(const uint8_t* data, size_t length) const
+		{
+			return Update(0, data, length);
+		}
+
+		// Carries on from the checksum of everything before, so that an entry can be checked as it streams past
+		uint32_t Update(uint32_t crc, const uint8_t* data, size_t length) const
+		{
+			crc ^= 0xFFFFFFFF;
+
+			for (size_t i = 0; i < length; ++i)
+			{
+				crc = Table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+			}
+
+			return crc ^ 0xFFFFFFFF;
+		}
+	};
+
+	const Crc32 Crc;
+
+	// Hands whatever a writer streams straight to the archive, so that a large entry is never held in memory
+	struct SinkBuffer : streambuf
+	{
+		StreamSink* Target;
+		uint32_t* Checksum;
+		uint64_t Length = 0;
+
+		SinkBuffer(StreamSink* target, uint32_t* checksum) : Target(target), Checksum(checksum)
+		{
+		}
+
+		streamsize xsputn(const char* data, streamsize length) override
+		{
+			Target->Put(data, static_cast<size_t>(length));
+
+			if (Checksum != nullptr)
+			{
+				*Checksum = Crc.Update(*Checksum, reinterpret_cast<const uint8_t*>(data), static_cast<size_t>(length));
+			}
+
+			Length += static_cast<uint64_t>(length);
+
+			return *Target->Out ? length : 0;
+		}
+
+		int_type overflow(int_type c) override
+		{
+			if (traits_type::eq_int_type(c, traits_type::eof()))
+			{
+				return traits_type::not_eof(c);
+			}
+
+			char data = traits_type::to_char_type(c);
+
+			return (xsputn(&data, 1) == 1) ? c : traits_type::eof();
+		}
+	};
+
+	void Append(vector<uint8_t>& buffer, uint64_t value, size_t bytes)
+	{
+		for (size_t i = 0; i < bytes; ++i)
+		{
+			buffer.push_back(static_cast<uint8_t>(value >> (i * 8)));
+		}
+	}
+
+	// Archives hold the same paths as the directory tree, minus any root
+	string EntryName(const path& fileName)
+	{
+		return fileName.relative_path().generic_string();
+	}
+}
+
+Sink* Sink::Create(const char* archiveName)
+{
+	if (archiveName != nullptr)
+	{
+		if (path(archiveName).extension() == ".zip")
+		{
+			return new ZipSink(archiveName);
+		}
+
+		return new TarSink(archiveName);
+	}
+
+#ifdef __linux__
+	UringSink* uring = new UringSink();
+
+	if (uring->Ring >= 0)
+	{
+		return uring;
+	}
+
+	delete uring;
+#endif
+
+	return new FileSink();
+}
+
+void Sink::Directory(const path& dirName)
+{
+	create_directory(dirName);
+}
+
+bool Sink::Files() const
+{
+	return true;
+}
+
+bool Sink::Stream(const path& fileName, uint64_t, const function<void(ostream&)>& write)
+{
+	ofstream ofs(fileName, ofstream::binary);
+
+	bool result = ofs.is_open();
+
+	try
+	{
+		write(ofs);
+		ofs.close();
+	}
+	catch (const exception&)
+	{
+		result = false;
+	}
+
+	if (!result || !ofs)
+	{
+		lock_guard<mutex> lock(Common::Console);
+
+		cerr << endl << "ERROR IN\t" << fileName.string() << endl;
+		cerr << "EXPECTED\tA writable file" << endl << endl;
+
+		return false;
+	}
+
+	return true;
+}
+
+bool FileSink::Write(const path& fileName, vector<uint8_t> data)
+{
+	ofstream ofs(fileName, ofstream::binary);
+	ofs.write(reinterpret_cast<const char*>(data.data()), static_cast<streamsize>(data.size()));
+	ofs.close();
+
+	if (!ofs)
+	{
+		lock_guard<mutex> lock(Common::Console);
+
+		cerr << endl << "ERROR IN\t" << fileName.string() << endl;
+		cerr << "EXPECTED\tA writable file" << endl << endl;
+
+		return false;
+	}
+
+	return true;
+}
+
+bool FileSink::Flush()
+{
+	return true;
+}
+
+StreamSink::StreamSink(const char* fileName) : Buffer(1 << 20), FileName(fileName)
+{
+	if (FileName == "-")
+	{
+#ifdef _WIN32
+		_setmode(_fileno(stdout), _O_BINARY);
+#endif
+		setvbuf(stdout, nullptr, _IOFBF, Buffer.size());
+
+		Out = &cout;
+	}
+	else
+	{
+		File.rdbuf()->pubsetbuf(Buffer.data(), static_cast<streamsize>(Buffer.size()));
+		File.open(FileName, ofstream::binary);
+
+		Out = &File;
+	}
+
+	if (!*Out)
+	{
+		Result = false;
+	}
+}
+
+bool StreamSink::Files() const
+{
+	return false;
+}
+
+void StreamSink::Put(const void* data, size_t length)
+{
+	Out->write(static_cast<const char*>(data), static_cast<streamsize>(length));
+
+	Offset += length;
+}
+
+bool StreamSink::Forward(uint64_t length, const function<void(ostream&)>& write, uint32_t* crc)
+{
+	SinkBuffer buffer(this, crc);
+	ostream out(&buffer);
+
+	bool result = true;
+
+	try
+	{
+		write(out);
+	}
+	catch (const exception&)
+	{
+		result = false;
+	}
+
+	// Anything short of the length in the header leaves every later entry out of place
+	if (!result || !out || (buffer.Length != length))
+	{
+		Result = false;
+
+		return false;
+	}
+
+	return true;
+}
+
+bool StreamSink::Close()
+{
+	Finished = true;
+
+	Out->flush();
+
+	if (Out == &File)
+	{
+		File.close();
+	}
+
+	if (!*Out)
+	{
+		Result = false;
+	}
+
+	if (!Result)
+	{
+		lock_guard<mutex> lock(Common::Console);
+
+		cerr << endl << "ERROR IN\t" << FileName << endl;
+		cerr << "EXPECTED\tA writable archive" << endl << endl;
+	}
+
+	return Result;
+}
+
+TarSink::TarSink(const char* fileName) : StreamSink(fileName)
+{
+}
+
+bool TarSink::Write(const path& fileName, vector<uint8_t> data)
+{
+	lock_guard<mutex> lock(Mutex);
+
+	Header(EntryName(fileName), data.size(), '0');
+	Put(data.data(), data.size());
+
+	uint8_t padding[512] = {};
+	Put(padding, (512 - (data.size() % 512)) % 512);
+
+	return true;
+}
+
+bool TarSink::Stream(const path& fileName, uint64_t length, const function<void(ostream&)>& write)
+{
+	lock_guard<mutex> lock(Mutex);
+
+	Header(EntryName(fileName), length, '0');
+
+	if (!Forward(length, write, nullptr))
+	{
+		lock_guard<mutex> consoleLock(Common::Console);
+
+		cerr << endl << "ERROR IN\t" << fileName.string() << endl;
+		cerr << "EXPECTED\tA writable file" << endl << endl;
+
+		return false;
+	}
+
+	uint8_t padding[512] = {};
+	Put(padding, (512 - (length % 512)) % 512);
+
+	return true;
+}
+
+bool TarSink::Flush()
+{
+	lock_guard<mutex> lock(Mutex);
+
+	if (Finished)
+	{
+		return Result;
+	}
+
+	uint8_t trailer[1024] = {};
+	Put(trailer, sizeof(trailer));
+
+	return Close();
+}
+
+void TarSink::Directory(const path& dirName)
+{
+	lock_guard<mutex> lock(Mutex);
+
+	if (!Directories.insert(EntryName(dirName)).second)
+	{
+		return;
+	}
+
+	Header(EntryName(dirName) + "/", 0, '5');
+}
+
+void TarSink::Header(string name, uint64_t size, char type)
+{
+	string prefix;
+
+	// A ustar header can only hold a long name split at a slash, anything else gets a pax header in front of it
+	if (name.length() > 100)
+	{
+		size_t slash = name.find('/', (name.length() > 101) ? (name.length() - 101) : 0);
+
+		if ((slash != string::npos) && (slash <= 155) && (slash != (name.length() - 1)))
+		{
+			prefix = name.substr(0, slash);
+			name = name.substr(slash + 1);
+		}
+	}
+
+	string records;
+
+	for (const auto& field : { make_pair(string("path"), (name.length() > 100) ? name : string()), make_pair(string("size"), (size > 077777777777) ? to_string(size) : string()) })
+	{
+		if (field.second.empty())
+		{
+			continue;
+		}
+
+		string record = " " + field.first + "=" + field.second + "\n";
+		size_t length = record.length() + 1;
+
+		while ((to_string(length) + record).length() != length)
+		{
+			++length;
+		}
+
+		records += to_string(length) + record;
+	}
+
+	if (!records.empty())
+	{
+		Header("PaxHeader", records.length(), 'x');
+		Put(records.data(), records.length());
+
+		uint8_t padding[512] = {};
+		Put(padding, (512 - (records.length() % 512)) % 512);
+
+		name = name.substr(0, 100);
+		size = min<uint64_t>(size, 077777777777);
+	}
+
+	char header[512] = {};
+
+	memcpy(header, name.data(), min<size_t>(name.length(), 100));
+	snprintf(header + 100, 8, "%07o", (type == '5') ? 0755 : 0644);
+	snprintf(header + 108, 8, "%07o", 0);
+	snprintf(header + 116, 8, "%07o", 0);
+	snprintf(header + 124, 12, "%011llo", static_cast<unsigned long long>(size));
+	snprintf(header + 136, 12, "%011o", 0);
+	memset(header + 148, ' ', 8);
+	header[156] = type;
+	memcpy(header + 257, "ustar", 6);
+	memcpy(header + 263, "00", 2);
+	memcpy(header + 345, prefix.data(), min<size_t>(prefix.length(), 155));
+
+	uint32_t checksum = 0;
+
+	for (size_t i = 0; i < sizeof(header); ++i)
+	{
+		checksum += static_cast<uint8_t>(header[i]);
+	}
+
+	snprintf(header + 148, 8, "%06o", checksum);
+	header[155] = ' ';
+
+	Put(header, sizeof(header));
+}
+
+ZipSink::ZipSink(const char* fileName) : StreamSink(fileName)
+{
+}
+
+bool ZipSink::Write(const path& fileName, vector<uint8_t> data)
+{
+	lock_guard<mutex> lock(Mutex);
+
+	Entry(EntryName(fileName), data);
+
+	return true;
+}
+
+bool ZipSink::Stream(const path& fileName, uint64_t length, const function<void(ostream&)>& write)
+{
+	lock_guard<mutex> lock(Mutex);
+
+	ZipEntry entry{ EntryName(fileName), 0, length, Offset };
+
+	Header(entry);
+
+	// The checksum is only known once the data has gone past, so it is filled into the local header afterwards
+	if (Forward(length, write, &entry.Crc))
+	{
+		uint8_t crc[4] = { static_cast<uint8_t>(entry.Crc), static_cast<uint8_t>(entry.Crc >> 8), static_cast<uint8_t>(entry.Crc >> 16), static_cast<uint8_t>(entry.Crc >> 24) };
+
+		Out->seekp(static_cast<streamoff>(entry.Offset + 14));
+		Out->write(reinterpret_cast<const char*>(crc), sizeof(crc));
+		Out->seekp(static_cast<streamoff>(Offset));
+
+		if (*Out)
+		{
+			Entries.push_back(entry);
+
+			return true;
+		}
+
+		Result = false;
+	}
+
+	lock_guard<mutex> consoleLock(Common::Console);
+
+	cerr << endl << "ERROR IN\t" << fileName.string() << endl;
+	cerr << "EXPECTED\tA writable file" << endl << endl;
+
+	return false;
+}
+
+bool ZipSink::Flush()
+{
+	lock_guard<mutex> lock(Mutex);
+
+	if (Finished)
+	{
+		return Result;
+	}
+
+	uint64_t directoryOffset = Offset;
+
+	for (size_t i = 0; i < Entries.size(); ++i)
+	{
+		const ZipEntry& entry = Entries[i];
+
+		vector<uint8_t> extra;
+
+		if (entry.Size >= 0xFFFFFFFF)
+		{
+			Append(extra, entry.Size, 8);
+			Append(extra, entry.Size, 8);
+		}
+
+		if (entry.Offset >= 0xFFFFFFFF)
+		{
+			Append(extra, entry.Offset, 8);
+		}
+
+		bool directory = !entry.Name.empty() && (entry.Name.back() == '/');
+
+		vector<uint8_t> header;
+		Append(header, 0x02014B50, 4);
+		Append(header, 0x0300 | 45, 2);
+		Append(header, extra.empty() ? 20 : 45, 2);
+		Append(header, 0x0800, 2);
+		Append(header, 0, 2);
+		Append(header, 0, 2);
+		Append(header, 0x0021, 2);
+		Append(header, entry.Crc, 4);
+		Append(header, min<uint64_t>(entry.Size, 0xFFFFFFFF), 4);
+		Append(header, min<uint64_t>(entry.Size, 0xFFFFFFFF), 4);
+		Append(header, entry.Name.length(), 2);
+		Append(header, extra.empty() ? 0 : (4 + extra.size()), 2);
+		Append(header, 0, 2);
+		Append(header, 0, 2);
+		Append(header, 0, 2);
+		Append(header, directory ? ((040755u << 16) | 0x10) : (0100644u << 16), 4);
+		Append(header, min<uint64_t>(entry.Offset, 0xFFFFFFFF), 4);
+
+		Put(header.data(), header.size());
+		Put(entry.Name.data(), entry.Name.length());
+
+		if (!extra.empty())
+		{
+			vector<uint8_t> field;
+			Append(field, 0x0001, 2);
+			Append(field, extra.size(), 2);
+
+			Put(field.data(), field.size());
+			Put(extra.data(), extra.size());
+		}
+	}
+
+	uint64_t directoryLength = Offset - directoryOffset;
+
+	vector<uint8_t> end;
+
+	// Past 65535 entries or 4 GiB the totals only fit in the Zip64 records
+	if ((Entries.size() >= 0xFFFF) || (directoryLength >= 0xFFFFFFFF) || (directoryOffset >= 0xFFFFFFFF))
+	{
+		uint64_t recordOffset = Offset;
+
+		Append(end, 0x06064B50, 4);
+		Append(end, 44, 8);
+		Append(end, 0x0300 | 45, 2);
+		Append(end, 45, 2);
+		Append(end, 0, 4);
+		Append(end, 0, 4);
+		Append(end, Entries.size(), 8);
+		Append(end, Entries.size(), 8);
+		Append(end, directoryLength, 8);
+		Append(end, directoryOffset, 8);
+
+		Append(end, 0x07064B50, 4);
+		Append(end, 0, 4);
+		Append(end, recordOffset, 8);
+		Append(end, 1, 4);
+	}
+
+	Append(end, 0x06054B50, 4);
+	Append(end, 0, 2);
+	Append(end, 0, 2);
+	Append(end, min<uint64_t>(Entries.size(), 0xFFFF), 2);
+	Append(end, min<uint64_t>(Entries.size(), 0xFFFF), 2);
+	Append(end, min<uint64_t>(directoryLength, 0xFFFFFFFF), 4);
+	Append(end, min<uint64_t>(directoryOffset, 0xFFFFFFFF), 4);
+	Append(end, 0, 2);
+
+	Put(end.data(), end.size());
+
+	return Close();
+}
+
+void ZipSink::Directory(const path& dirName)
+{
+	lock_guard<mutex> lock(Mutex);
+
+	if (!Directories.insert(EntryName(dirName)).second)
+	{
+		return;
+	}
+
+	Entry(EntryName(dirName) + "/", {});
+}
+
+void ZipSink::Entry(string name, const vector<uint8_t>& data)
+{
+	ZipEntry entry{ name, Crc.Compute(data.data(), data.size()), data.size(), Offset };
+
+	Header(entry);
+	Put(data.data(), data.size());
+
+	Entries.push_back(entry);
+}
+
+void ZipSink::Header(const ZipEntry& entry)
+{
+	vector<uint8_t> extra;
+
+	if (entry.Size >= 0xFFFFFFFF)
+	{
+		Append(extra, 0x0001, 2);
+		Append(extra, 16, 2);
+		Append(extra, entry.Size, 8);
+		Append(extra, entry.Size, 8);
+	}
+
+	vector<uint8_t> header;
+	Append(header, 0x04034B50, 4);
+	Append(header, extra.empty() ? 20 : 45, 2);
+	Append(header, 0x0800, 2);
+	Append(header, 0, 2);
+	Append(header, 0, 2);
+	Append(header, 0x0021, 2);
+	Append(header, entry.Crc, 4);
+	Append(header, min<uint64_t>(entry.Size, 0xFFFFFFFF), 4);
+	Append(header, min<uint64_t>(entry.Size, 0xFFFFFFFF), 4);
+	Append(header, entry.Name.length(), 2);
+	Append(header, extra.size(), 2);
+
+	Put(header.data(), header.size());
+	Put(entry.Name.data(), entry.Name.length());
+	Put(extra.data(), extra.size());
+}
+
+#ifdef __linux__
+UringSink::UringSink()
+{
+	io_uring_params params{};
+
+	Ring = static_cast<int>(syscall(__NR_io_uring_setup, Entries, &params));
+
+	if (Ring < 0)
+	{
+		return;
+	}
+
+	// Opening straight into a fixed file slot needs 5.15, which every kernel that skips completions has
+	if ((params.features & IORING_FEAT_CQE_SKIP) == 0)
+	{
+		close(Ring);
+		Ring = -1;
+
+		return;
+	}
+
+	SqRingLength = params.sq_off.array + (params.sq_entries * sizeof(uint32_t));
+	CqRingLength = params.cq_off.cqes + (params.cq_entries * sizeof(io_uring_cqe));
+	SqesLength = params.sq_entries * sizeof(io_uring_sqe);
+
+	if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0)
+	{
+		SqRingLength = CqRingLength = max(SqRingLength, CqRingLength);
+	}
+
+	void* sqRing = mmap(nullptr, SqRingLength, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Ring, IORING_OFF_SQ_RING);
+	void* cqRing = ((params.features & IORING_FEAT_SINGLE_MMAP) != 0) ? sqRing : mmap(nullptr, CqRingLength, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Ring, IORING_OFF_CQ_RING);
+	void* sqes = mmap(nullptr, SqesLength, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Ring, IORING_OFF_SQES);
+
+	SqRing = (sqRing != MAP_FAILED) ? static_cast<uint8_t*>(sqRing) : nullptr;
+	CqRing = (cqRing != MAP_FAILED) ? static_cast<uint8_t*>(cqRing) : nullptr;
+	Sqes = (sqes != MAP_FAILED) ? static_cast<io_uring_sqe*>(sqes) : nullptr;
+
+	// Each write is opened into a slot of a sparse table of fixed files, so that its write and close can be linked to the open
+	vector<int> files(Slots, -1);
+
+	if ((SqRing == nullptr) || (CqRing == nullptr) || (Sqes == nullptr) || (syscall(__NR_io_uring_register, Ring, IORING_REGISTER_FILES, files.data(), Slots) < 0))
+	{
+		close(Ring);
+		Ring = -1;
+
+		return;
+	}
+
+	SqTail = reinterpret_cast<uint32_t*>(SqRing + params.sq_off.tail);
+	SqMask = *reinterpret_cast<uint32_t*>(SqRing + params.sq_off.ring_mask);
+	SqArray = reinterpret_cast<uint32_t*>(SqRing + params.sq_off.array);
+	CqHead = reinterpret_cast<uint32_t*>(CqRing + params.cq_off.head);
+	CqTail = reinterpret_cast<uint32_t*>(CqRing + params.cq_off.tail);
+	CqMask = *reinterpret_cast<uint32_t*>(CqRing + params.cq_off.ring_mask);
+	Cqes = reinterpret_cast<io_uring_cqe*>(CqRing + params.cq_off.cqes);
+
+	for (uint32_t i = 0; i < Slots; ++i)
+	{
+		FreeSlots.push_back(Slots - 1 - i);
+	}
+}
+
+UringSink::~UringSink()
+{
+	if (Ring >= 0)
+	{
+		Flush();
+	}
+
+	if (Sqes != nullptr)
+	{
+		munmap(Sqes, SqesLength);
+	}
+
+	if ((CqRing != nullptr) && (CqRing != SqRing))
+	{
+		munmap(CqRing, CqRingLength);
+	}
+
+	if (SqRing != nullptr)
+	{
+		munmap(SqRing, SqRingLength);
+	}
+
+	if (Ring >= 0)
+	{
+		close(Ring);
+	}
+}
+
+bool UringSink::Write(const path& fileName, vector<uint8_t> data)
+{
+	// A single write is capped just under 2 GiB, so anything bigger goes through a stream
+	if (data.size() > 0x7FFFF000)
+	{
+		return FileSink().Write(fileName, move(data));
+	}
+
+	lock_guard<mutex> lock(Mutex);
+
+	while (FreeSlots.empty() && !Broken)
+	{
+		Submit();
+		Reap(true);
+	}
+
+	// Once the ring stops taking submissions, everything else is written synchronously
+	if (Broken)
+	{
+		return FileSink().Write(fileName, move(data));
+	}
+
+	UringWrite* write = new UringWrite{ fileName.string(), move(data), FreeSlots.back() };
+
+	FreeSlots.pop_back();
+	++InFlight;
+
+	uint64_t userData = reinterpret_cast<uint64_t>(write);
+
+	io_uring_sqe* openSqe = Next();
+	openSqe->opcode = IORING_OP_OPENAT;
+	openSqe->flags = IOSQE_IO_LINK;
+	openSqe->fd = AT_FDCWD;
+	openSqe->addr = reinterpret_cast<uint64_t>(write->FileName.c_str());
+	openSqe->len = 0644;
+	openSqe->open_flags = O_WRONLY | O_CREAT | O_TRUNC;
+	openSqe->file_index = write->Slot + 1;
+	openSqe->user_data = userData;
+
+	io_uring_sqe* writeSqe = Next();
+	writeSqe->opcode = IORING_OP_WRITE;
+	writeSqe->flags = IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+	writeSqe->fd = static_cast<int32_t>(write->Slot);
+	writeSqe->addr = reinterpret_cast<uint64_t>(write->Data.data());
+	writeSqe->len = static_cast<uint32_t>(write->Data.size());
+	writeSqe->off = 0;
+	writeSqe->user_data = userData | 1;
+
+	io_uring_sqe* closeSqe = Next();
+	closeSqe->opcode = IORING_OP_CLOSE;
+	closeSqe->file_index = write->Slot + 1;
+	closeSqe->user_data = userData | 2;
+
+	Publish();
+
+	if (Queued >= (Batch * 3))
+	{
+		Submit();
+	}
+
+	Reap(false);
+
+	return true;
+}
+
+bool UringSink::Flush()
+{
+	lock_guard<mutex> lock(Mutex);
+
+	Submit();
+
+	while ((InFlight != 0) && !Broken)
+	{
+		Reap(true);
+	}
+
+	return Result;
+}
+
+io_uring_sqe* UringSink::Next()
+{
+	io_uring_sqe* sqe = &Sqes[(*SqTail + Filled++) & SqMask];
+	memset(sqe, 0, sizeof(io_uring_sqe));
+
+	return sqe;
+}
+
+void UringSink::Publish()
+{
+	uint32_t tail = *SqTail;
+
+	for (uint32_t i = 0; i < Filled; ++i)
+	{
+		SqArray[(tail + i) & SqMask] = (tail + i) & SqMask;
+	}
+
+	// The kernel may read the entries as soon as it sees the new tail, so it only moves once they are all filled in
+	__atomic_store_n(SqTail, tail + Filled, __ATOMIC_RELEASE);
+
+	Queued += Filled;
+	Filled = 0;
+}
+
+void UringSink::Submit()
+{
+	while (Queued != 0)
+	{
+		long submitted = syscall(__NR_io_uring_enter, Ring, Queued, 0, 0, nullptr, 0);
+
+		if (submitted > 0)
+		{
+			Queued -= static_cast<uint32_t>(submitted);
+		}
+		else if ((submitted < 0) && (errno != EINTR) && (errno != EAGAIN) && (errno != EBUSY))
+		{
+			lock_guard<mutex> lock(Common::Console);
+
+			cerr << endl << "ERROR IN\tio_uring_enter" << endl;
+			cerr << "EXPECTED\tSubmitted writes" << endl << endl;
+
+			Result = false;
+			Broken = true;
+
+			return;
+		}
+		else
+		{
+			Reap(InFlight != 0);
+		}
+	}
+}
+
+void UringSink::Reap(bool wait)
+{
+	if (wait)
+	{
+		while ((syscall(__NR_io_uring_enter, Ring, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0) && (errno == EINTR))
+		{
+		}
+	}
+
+	uint32_t head = *CqHead;
+	uint32_t tail = __atomic_load_n(CqTail, __ATOMIC_ACQUIRE);
+
+	for (; head != tail; ++head)
+	{
+		io_uring_cqe* cqe = &Cqes[head & CqMask];
+		UringWrite* write = reinterpret_cast<UringWrite*>(cqe->user_data & ~static_cast<uint64_t>(3));
+
+		switch (cqe->user_data & 3)
+		{
+			case 0:
+			{
+				write->Opened = cqe->res;
+
+				break;
+			}
+
+			case 1:
+			{
+				write->Written = cqe->res;
+
+				break;
+			}
+
+			default:
+			{
+				write->Closed = cqe->res;
+
+				break;
+			}
+		}
+
+		if (++write->Completed == 3)
+		{
+			Complete(write);
+		}
+	}
+
+	__atomic_store_n(CqHead, head, __ATOMIC_RELEASE);
+}
+
+void UringSink::Complete(UringWrite* write)
+{
+	// A slot whose close never ran still holds its file
+	if ((write->Opened >= 0) && (write->Closed < 0))
+	{
+		int file = -1;
+
+		io_uring_files_update update{};
+		update.offset = write->Slot;
+		update.fds = reinterpret_cast<uint64_t>(&file);
+
+		syscall(__NR_io_uring_register, Ring, IORING_REGISTER_FILES_UPDATE, &update, 1);
+	}
+
+	int error = 0;
+
+	// Steps cancelled by an earlier failure in the chain say nothing about the file
+	for (int res : { write->Opened, write->Written, write->Closed })
+	{
+		if ((res < 0) && (res != -ECANCELED) && (error == 0))
+		{
+			error = -res;
+		}
+	}
+
+	if (error != 0)
+	{
+		lock_guard<mutex> lock(Common::Console);
+
+		cerr << endl << "ERROR IN\t" << write->FileName << endl;
+		cerr << "EXPECTED\tA writable file" << endl;
+		cerr << "INSTEAD GOT\t" << strerror(error) << endl << endl;
+
+		Result = false;
+	}
+	// Anything the ring could not write in one go is written again synchronously
+	else if ((write->Opened < 0) || (write->Written < 0) || (static_cast<size_t>(write->Written) != write->Data.size()) || (write->Closed < 0))
+	{
+		if (!FileSink().Write(write->FileName, move(write->Data)))
+		{
+			Result = false;
+		}
+	}
+
+	FreeSlots.push_back(write->Slot);
+	--InFlight;
+
+	delete write;
+}
+#endif
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+struct Sink
+{
+	virtual ~Sink() = default;
+	virtual bool Write(const std::filesystem::path& fileName, std::vector<uint8_t> data) = 0;
+	virtual bool Stream(const std::filesystem::path& fileName, uint64_t length, const std::function<void(std::ostream&)>& write);
+	virtual bool Flush() = 0;
+	virtual void Directory(const std::filesystem::path& dirName);
+	virtual bool Files() const;
+
+	static Sink* Create(const char* archiveName = nullptr);
+};
+
+struct FileSink : Sink
+{
+	bool Write(const std::filesystem::path& fileName, std::vector<uint8_t> data) override;
+	bool Flush() override;
+};
+
+struct StreamSink : Sink
+{
+	std::ofstream File;
+	std::ostream* Out = nullptr;
+	std::vector<char> Buffer;
+	std::string FileName;
+	std::set<std::string> Directories;
+	uint64_t Offset = 0;
+	bool Result = true;
+	bool Finished = false;
+	std::mutex Mutex;
+
+	StreamSink(const char* fileName);
+	bool Files() const override;
+	void Put(const void* data, size_t length);
+	bool Forward(uint64_t length, const std::function<void(std::ostream&)>& write, uint32_t* crc);
+	bool Close();
+};
+
+struct TarSink : StreamSink
+{
+	TarSink(const char* fileName);
+	bool Write(const std::filesystem::path& fileName, std::vector<uint8_t> data) override;
+	bool Stream(const std::filesystem::path& fileName, uint64_t length, const std::function<void(std::ostream&)>& write) override;
+	bool Flush() override;
+	void Directory(const std::filesystem::path& dirName) override;
+	void Header(std::string name, uint64_t size, char type);
+};
+
+struct ZipEntry
+{
+	std::string Name;
+	uint32_t Crc;
+	uint64_t Size;
+	uint64_t Offset;
+};
+
+struct ZipSink : StreamSink
+{
+	std::vector<ZipEntry> Entries;
+
+	ZipSink(const char* fileName);
+	bool Write(const std::filesystem::path& fileName, std::vector<uint8_t> data) override;
+	bool Stream(const std::filesystem::path& fileName, uint64_t length, const std::function<void(std::ostream&)>& write) override;
+	bool Flush() override;
+	void Directory(const std::filesystem::path& dirName) override;
+	void Entry(std::string name, const std::vector<uint8_t>& data);
+	void Header(const ZipEntry& entry);
+};
+
+#ifdef __linux__
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+struct UringWrite
+{
+	std::string FileName;
+	std::vector<uint8_t> Data;
+	uint32_t Slot;
+
+	int Opened = 0;
+	int Written = 0;
+	int Closed = 0;
+	uint8_t Completed = 0;
+};
+
+struct UringSink : Sink
+{
+	static const uint32_t Entries = 256;
+	static const uint32_t Slots = 64;
+	static const uint32_t Batch = 16;
+
+	int Ring = -1;
+	uint8_t* SqRing = nullptr;
+	size_t SqRingLength = 0;
+	uint8_t* CqRing = nullptr;
+	size_t CqRingLength = 0;
+	io_uring_sqe* Sqes = nullptr;
+	size_t SqesLength = 0;
+
+	uint32_t* SqTail = nullptr;
+	uint32_t SqMask = 0;
+	uint32_t* SqArray = nullptr;
+	uint32_t* CqHead = nullptr;
+	uint32_t* CqTail = nullptr;
+	uint32_t CqMask = 0;
+	io_uring_cqe* Cqes = nullptr;
+
+	std::vector<uint32_t> FreeSlots;
+	uint32_t Filled = 0;
+	uint32_t Queued = 0;
+	size_t InFlight = 0;
+	bool Result = true;
+	bool Broken = false;
+	std::mutex Mutex;
+
+	UringSink();
+	~UringSink();
+	bool Write(const std::filesystem::path& fileName, std::vector<uint8_t> data) override;
+	bool Flush() override;
+	io_uring_sqe* Next();
+	void Publish();
+	void Submit();
+	void Reap(bool wait);
+	void Complete(UringWrite* write);
+};
+#endif
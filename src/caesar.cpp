@@ -1,48 +1,211 @@
+#include "Cache.hpp"
 #include "Common.hpp"
 #include "Csar.hpp"
+#include "Pool.hpp"
+#include "Sink.hpp"
 
+#include <algorithm>
+#include <cstdlib>
 #include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <string>
+#include <vector>
 
 using namespace std;
+using namespace filesystem;
+
+static bool ReadManifest(const char* fileName, vector<string>& inputs)
+{
+	ifstream ifs(fileName);
+
+	if (!ifs.is_open())
+	{
+		cerr << endl << "ERROR IN\t" << fileName << endl;
+		cerr << "EXPECTED\tA readable manifest" << endl << endl;
+
+		return false;
+	}
+
+	string line;
+
+	while (getline(ifs, line))
+	{
+		if (!line.empty() && (line.back() == '\r'))
+		{
+			line.pop_back();
+		}
+
+		if (!line.empty())
+		{
+			inputs.push_back(line);
+		}
+	}
+
+	return true;
+}
+
+static bool Extract(const string& input, bool p, Pool* workers)
+{
+	Csar csar(input.c_str(), p, workers);
+
+	// Inside an archive every input is rooted at its own name, wherever it was read from
+	return csar.Extract(Common::Output->Files() ? path(input).replace_extension() : path(input).filename().replace_extension());
+}
 
 int main(int argc, char* argv[])
 {
+	bool b = false;
 	bool p = false;
+	const char* archiveName = nullptr;
+	Pool* workers = nullptr;
+	vector<string> inputs;
 
 	if (argc == 1)
 	{
 		cout << "OVERVIEW: Caesar" << endl << endl;
 		cout << "USAGE: caesar [options] <inputs>" << endl << endl;
 		cout << "OPTIONS:" << endl;
+		cout << "\t-b\tExtract all inputs concurrently and continue past failures" << endl;
+		cout << "\t-c DIR\tReuse waves decoded by earlier runs from a cache in DIR" << endl;
+		cout << "\t-d\tDump embedded files" << endl;
+		cout << "\t-j N\tUse N threads" << endl;
+		cout << "\t-m FILE\tRead inputs from FILE, one per line" << endl;
+		cout << "\t-o FILE\tWrite all outputs into FILE, a zip if it ends in .zip and a tar otherwise, or - for a tar on stdout" << endl;
 		cout << "\t-p\tDo not ignore pan values of stereo samples" << endl;
+		cout << "\t-r\tOnly decode waves that an instrument references" << endl;
+		cout << "\t-s\tWrite every bank of an archive into one SF2" << endl;
+		cout << "\t-u\tOnly convert what changed since the last run into the same directory" << endl;
 		cout << "\t-w\tShow warnings" << endl;
 
 		return 1;
 	}
-	else
+
+	for (int i = 1; i < argc; ++i)
 	{
-		for (int i = 1; i < argc; ++i)
+		if (!strcmp(argv[i], "-b"))
+		{
+			b = true;
+		}
+		else if (!strcmp(argv[i], "-c") && ((i + 1) < argc))
+		{
+			delete Common::Decoded;
+
+			Common::Decoded = new Cache(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "-d"))
+		{
+			Common::DumpFiles = true;
+		}
+		else if (!strcmp(argv[i], "-j") && ((i + 1) < argc))
 		{
-			if (!strcmp(argv[i], "-p"))
+			delete workers;
+
+			workers = new Pool(static_cast<unsigned>(max(atoi(argv[++i]), 1)));
+		}
+		else if (!strcmp(argv[i], "-m") && ((i + 1) < argc))
+		{
+			if (!ReadManifest(argv[++i], inputs))
 			{
-				p = true;
+				delete Common::Decoded;
+				delete workers;
+
+				return 1;
 			}
-			else if (!strcmp(argv[i], "-w"))
+		}
+		else if (!strcmp(argv[i], "-o") && ((i + 1) < argc))
+		{
+			archiveName = argv[++i];
+		}
+		else if (!strcmp(argv[i], "-p"))
+		{
+			p = true;
+		}
+		else if (!strcmp(argv[i], "-r"))
+		{
+			Common::OnDemand = true;
+		}
+		else if (!strcmp(argv[i], "-s"))
+		{
+			Common::SingleSoundFont = true;
+		}
+		else if (!strcmp(argv[i], "-u"))
+		{
+			Common::Incremental = true;
+		}
+		else if (!strcmp(argv[i], "-w"))
+		{
+			Common::ShowWarnings = true;
+		}
+		else
+		{
+			inputs.push_back(argv[i]);
+		}
+	}
+
+	Sink* sink = Sink::Create(archiveName);
+	Common::Output = sink;
+
+	if ((archiveName != nullptr) && !strcmp(archiveName, "-"))
+	{
+		Common::Progress = &cerr;
+	}
+
+	bool extracted = true;
+	vector<string> failures;
+
+	if (!b)
+	{
+		for (size_t i = 0; i < inputs.size(); ++i)
+		{
+			if (!Extract(inputs[i], p, workers))
 			{
-				Common::ShowWarnings = true;
+				extracted = false;
+
+				break;
 			}
-			else
-			{
-				Csar csar(argv[i], p);
+		}
+	}
+	else
+	{
+		Tasks tasks(workers);
+		vector<Job*> jobs;
+
+		for (size_t i = 0; i < inputs.size(); ++i)
+		{
+			const string& input = inputs[i];
+
+			jobs.push_back(tasks.Run([&input, p, workers] { return Extract(input, p, workers); }));
+		}
 
-				if (!csar.Extract())
-				{
-					return 1;
-				}
+		tasks.Wait();
+
+		for (size_t i = 0; i < inputs.size(); ++i)
+		{
+			if (!jobs[i]->Result)
+			{
+				failures.push_back(inputs[i]);
 			}
 		}
 	}
 
-	return 0;
+	// Files may still be in flight, so nothing has been written for certain until the sink is flushed
+	bool written = sink->Flush();
+
+	delete sink;
+	delete Common::Decoded;
+	delete workers;
+
+	if (b)
+	{
+		*Common::Progress << endl << "EXTRACTED\t" << (inputs.size() - failures.size()) << " of " << inputs.size() << endl;
+
+		for (size_t i = 0; i < failures.size(); ++i)
+		{
+			*Common::Progress << "FAILED\t\t" << failures[i] << endl;
+		}
+	}
+
+	return (extracted && failures.empty() && written) ? 0 : 1;
 }
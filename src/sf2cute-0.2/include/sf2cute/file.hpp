@@ -6,6 +6,7 @@
 #ifndef SF2CUTE_FILE_HPP_
 #define SF2CUTE_FILE_HPP_
 
+#include <stddef.h>
 #include <algorithm>
 #include <memory>
 #include <utility>
@@ -390,6 +391,15 @@ public:
     software_.clear();
   }
 
+  /// Returns the length of the file that Write produces.
+  ///
+  /// The length is known before anything is written, so a destination that
+  /// needs it up front can still be written to as a stream.
+  ///
+  /// @return the length of the SoundFont file, in terms of bytes.
+  /// @throws std::length_error The file size exceeds the maximum.
+  size_t GetFileSize();
+
   /// Writes the SoundFont to a file.
   /// @param filename the name of the file to write to.
   /// @throws std::logic_error The SoundFont has a structural error.
@@ -403,6 +413,11 @@ public:
   /// @copydoc SoundFont::Write(std::ostream &)
   void Write(std::ostream && out);
 
+  /// Writes the SoundFont to a memory buffer.
+  /// @param data the buffer to write to, resized to the exact length of the file.
+  /// @throws std::logic_error The SoundFont has a structural error.
+  void Write(std::vector<uint8_t> & data);
+
 private:
   /// The default value of the target sound engine.
   static constexpr auto kDefaultTargetSoundEngine = "EMU8000";
@@ -413,6 +428,12 @@ private:
   /// Sets backward references of every children elements.
   void SetBackwardReferences() noexcept;
 
+  /// Renumbers the instruments after some of them have been removed.
+  void IndexInstruments() noexcept;
+
+  /// Renumbers the samples after some of them have been removed.
+  void IndexSamples() noexcept;
+
   /// Repairs references in the copied children elements.
   /// @param origin a SoundFont object used to construct this SoundFont object.
   void RepairReferences(const SoundFont & origin);
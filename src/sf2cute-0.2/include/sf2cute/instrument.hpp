@@ -6,6 +6,7 @@
 #ifndef SF2CUTE_INSTRUMENT_HPP_
 #define SF2CUTE_INSTRUMENT_HPP_
 
+#include <stddef.h>
 #include <algorithm>
 #include <memory>
 #include <utility>
@@ -163,6 +164,12 @@ public:
     return *parent_file_;
   }
 
+  /// Returns the position of this instrument in the parent file.
+  /// @return the position of this instrument in the parent file.
+  size_t index() const noexcept {
+    return index_;
+  }
+
 private:
   /// Sets the parent file.
   /// @param parent_file the parent file.
@@ -175,6 +182,12 @@ private:
     parent_file_ = nullptr;
   }
 
+  /// Sets the position of this instrument in the parent file.
+  /// @param index the position of this instrument in the parent file.
+  void set_index(size_t index) noexcept {
+    index_ = index;
+  }
+
   /// Sets backward references of every children elements.
   void SetBackwardReferences() noexcept;
 
@@ -189,6 +202,9 @@ private:
 
   /// The parent file.
   SoundFont * parent_file_;
+
+  /// The position in the parent file.
+  size_t index_;
 };
 
 } // namespace sf2cute
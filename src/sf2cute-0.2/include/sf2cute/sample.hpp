@@ -7,8 +7,10 @@
 #define SF2CUTE_SAMPLE_HPP_
 
 #include <stdint.h>
+#include <stddef.h>
 #include <algorithm>
 #include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -20,6 +22,33 @@ class SFSample;
 class SoundFont;
 class SoundFontWriter;
 
+/// The SFSampleData struct refers to the sample data of a sample.
+struct SFSampleData {
+  /// The owner of the sample data, kept alive for as long as the data is in use.
+  std::shared_ptr<const void> owner;
+
+  /// The first sample data point.
+  const int16_t * points;
+
+  /// The distance between consecutive sample data points, in sample data points.
+  size_t stride;
+};
+
+/// The SFSampleSource class produces sample data only when it is written.
+///
+/// @remarks A sample that is backed by a source keeps none of its data
+/// in memory, so a whole SoundFont can be written while only one sample
+/// is resident at a time.
+class SFSampleSource {
+public:
+  /// Destructs the SFSampleSource.
+  virtual ~SFSampleSource() = default;
+
+  /// Produces the sample data.
+  /// @return the sample data, which must hold as many data points as the sample's size.
+  virtual SFSampleData Load() const = 0;
+};
+
 /// The SFSample class represents a sample header and data.
 ///
 /// @remarks This class represents the official sfSample type and
@@ -82,6 +111,46 @@ public:
       std::weak_ptr<SFSample> link,
       SFSampleLink type);
 
+  /// Constructs a new SFSample that borrows its sample data.
+  /// @param name the name of the sample.
+  /// @param owner the owner of the sample data, kept alive for as long as the sample refers to it.
+  /// @param data the first sample data point.
+  /// @param size the number of sample data points.
+  /// @param stride the distance between consecutive sample data points, in sample data points.
+  /// @param start_loop the beginning index of the loop, in sample data points, inclusive.
+  /// @param end_loop the ending index of the loop, in sample data points, exclusive.
+  /// @param sample_rate the sample rate, in hertz.
+  /// @param original_key the MIDI key number of the recorded pitch of the sample.
+  /// @param correction the pitch correction that should be applied to the sample, in cents.
+  SFSample(std::string name,
+      std::shared_ptr<const void> owner,
+      const int16_t * data,
+      size_t size,
+      size_t stride,
+      uint32_t start_loop,
+      uint32_t end_loop,
+      uint32_t sample_rate,
+      uint8_t original_key,
+      int8_t correction);
+
+  /// Constructs a new SFSample whose sample data is produced when it is written.
+  /// @param name the name of the sample.
+  /// @param source the source of the sample data.
+  /// @param size the number of sample data points.
+  /// @param start_loop the beginning index of the loop, in sample data points, inclusive.
+  /// @param end_loop the ending index of the loop, in sample data points, exclusive.
+  /// @param sample_rate the sample rate, in hertz.
+  /// @param original_key the MIDI key number of the recorded pitch of the sample.
+  /// @param correction the pitch correction that should be applied to the sample, in cents.
+  SFSample(std::string name,
+      std::shared_ptr<const SFSampleSource> source,
+      size_t size,
+      uint32_t start_loop,
+      uint32_t end_loop,
+      uint32_t sample_rate,
+      uint8_t original_key,
+      int8_t correction);
+
   /// Constructs a new copy of specified SFSample.
   /// @param origin a SFSample object.
   SFSample(const SFSample & origin);
@@ -220,10 +289,50 @@ public:
 
   /// Returns the sample data.
   /// @return the sample data.
-  const std::vector<int16_t> & data() const noexcept {
+  /// @throws std::length_error The source produced no sample data.
+  /// @remarks A sample that borrows its data or is backed by a source
+  /// gathers a copy of it on the first call and keeps it, so this function
+  /// must not be called concurrently on such a sample. Use points() or
+  /// Load() to read the data without copying it.
+  const std::vector<int16_t> & data() const;
+
+  /// Returns the sample data without copying it.
+  /// @return a pointer to the first sample data point.
+  /// @remarks Consecutive sample data points are stride() apart.
+  /// This function returns nullptr if the sample is backed by a source.
+  const int16_t * points() const noexcept {
     return data_;
   }
 
+  /// Returns the number of sample data points.
+  /// @return the number of sample data points.
+  size_t size() const noexcept {
+    return size_;
+  }
+
+  /// Returns the distance between consecutive sample data points.
+  /// @return the distance between consecutive sample data points, in sample data points.
+  size_t stride() const noexcept {
+    return stride_;
+  }
+
+  /// Returns the owner of the sample data.
+  /// @return a pointer to the owner of the sample data.
+  const std::shared_ptr<const void> & owner() const noexcept {
+    return owner_;
+  }
+
+  /// Returns the source of the sample data.
+  /// @return a pointer to the source of the sample data, or nullptr if the sample holds its data.
+  const std::shared_ptr<const SFSampleSource> & source() const noexcept {
+    return source_;
+  }
+
+  /// Returns the sample data, producing it from the source if necessary.
+  /// @return the sample data.
+  /// @throws std::length_error The source produced no sample data.
+  SFSampleData Load() const;
+
   /// Returns true if this sample has a parent file.
   /// @return true if this sample has a parent file.
   bool has_parent_file() const noexcept {
@@ -236,7 +345,17 @@ public:
     return *parent_file_;
   }
 
+  /// Returns the position of this sample in the parent file.
+  /// @return the position of this sample in the parent file.
+  size_t index() const noexcept {
+    return index_;
+  }
+
 private:
+  /// Takes ownership of the specified sample data.
+  /// @param data the sample data.
+  void set_owned_data(std::vector<int16_t> data);
+
   /// Sets the parent file.
   /// @param parent_file the parent file.
   void set_parent_file(SoundFont & parent_file) noexcept {
@@ -248,6 +367,12 @@ private:
     parent_file_ = nullptr;
   }
 
+  /// Sets the position of this sample in the parent file.
+  /// @param index the position of this sample in the parent file.
+  void set_index(size_t index) noexcept {
+    index_ = index;
+  }
+
   /// The name of sample.
   std::string name_;
 
@@ -272,11 +397,29 @@ private:
   /// Both the type of sample and the whether the sample is located in RAM or ROM memory.
   SFSampleLink type_;
 
-  /// The sample data.
-  std::vector<int16_t> data_;
+  /// The source of the sample data.
+  std::shared_ptr<const SFSampleSource> source_;
+
+  /// The owner of the sample data.
+  std::shared_ptr<const void> owner_;
+
+  /// The sample data as a vector of its own, if the sample owns it or has been asked for it.
+  mutable std::shared_ptr<const std::vector<int16_t>> owned_data_;
+
+  /// The first sample data point.
+  const int16_t * data_;
+
+  /// The number of sample data points.
+  size_t size_;
+
+  /// The distance between consecutive sample data points.
+  size_t stride_;
 
   /// The parent file.
   SoundFont * parent_file_;
+
+  /// The position in the parent file.
+  size_t index_;
 };
 
 } // namespace sf2cute
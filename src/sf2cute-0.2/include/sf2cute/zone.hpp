@@ -54,7 +54,7 @@ public:
   virtual ~SFZone() = default;
 
   /// Returns the list of generators.
-  /// @return the list of generators assigned to the zone.
+  /// @return the list of generators assigned to the zone, in the order required by the generator chunk.
   const std::vector<std::unique_ptr<SFGeneratorItem>> & generators() const noexcept {
     return generators_;
   }
@@ -62,6 +62,7 @@ public:
   /// Sets a generator to the zone.
   /// @param generator a generator to be assigned to the zone.
   /// @remarks An existing generator which has the same key will be overwritten.
+  /// @remarks A new generator is inserted in the order required by the generator chunk.
   void SetGenerator(SFGeneratorItem generator);
 
   /// Finds the generator which is the specified type.
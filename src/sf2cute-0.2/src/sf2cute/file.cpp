@@ -252,6 +252,7 @@ void SoundFont::AddInstrument(std::shared_ptr<SFInstrument> instrument) {
 
   // Set this file to the parent file of the instrument.
   instrument->set_parent_file(*this);
+  instrument->set_index(instruments_.size());
 
   // Add the instrument to the list.
   instruments_.push_back(instrument);
@@ -270,6 +271,7 @@ void SoundFont::RemoveInstrument(
   const std::shared_ptr<SFInstrument> & instrument = *position;
   instrument->reset_parent_file();
   instruments_.erase(position);
+  IndexInstruments();
 }
 
 /// Removes an instrument from the SoundFont.
@@ -281,6 +283,7 @@ void SoundFont::RemoveInstrument(
     instrument->reset_parent_file();
   }
   instruments_.erase(first, last);
+  IndexInstruments();
 }
 
 /// Removes an instrument from the SoundFont.
@@ -296,6 +299,7 @@ void SoundFont::RemoveInstrumentIf(
         return false;
       }
     }), instruments_.end());
+  IndexInstruments();
 }
 
 /// Removes all of the instruments.
@@ -327,6 +331,7 @@ void SoundFont::AddSample(std::shared_ptr<SFSample> sample) {
 
   // Set this file to the parent file of the sample.
   sample->set_parent_file(*this);
+  sample->set_index(samples_.size());
 
   // Add the sample to the list.
   samples_.push_back(sample);
@@ -338,6 +343,7 @@ void SoundFont::RemoveSample(
   const std::shared_ptr<SFSample> & sample = *position;
   sample->reset_parent_file();
   samples_.erase(position);
+  IndexSamples();
 }
 
 /// Removes a sample from the SoundFont.
@@ -349,6 +355,7 @@ void SoundFont::RemoveSample(
     sample->reset_parent_file();
   }
   samples_.erase(first, last);
+  IndexSamples();
 }
 
 /// Removes a sample from the SoundFont.
@@ -364,6 +371,7 @@ void SoundFont::RemoveSampleIf(
         return false;
       }
     }), samples_.end());
+  IndexSamples();
 }
 
 /// Removes all of the samples.
@@ -374,6 +382,12 @@ void SoundFont::ClearSamples() noexcept {
   samples_.clear();
 }
 
+/// Returns the length of the file that Write produces.
+size_t SoundFont::GetFileSize() {
+  SoundFontWriter writer(*this);
+  return writer.GetFileSize();
+}
+
 /// Writes the SoundFont to a file.
 void SoundFont::Write(const std::string & filename) {
   SoundFontWriter writer(*this);
@@ -391,6 +405,12 @@ void SoundFont::Write(std::ostream && out) {
   Write(out);
 }
 
+/// Writes the SoundFont to a memory buffer.
+void SoundFont::Write(std::vector<uint8_t> & data) {
+  SoundFontWriter writer(*this);
+  writer.Write(data);
+}
+
 /// Sets backward references of every children elements.
 void SoundFont::SetBackwardReferences() noexcept {
   // Set backward reference from presets to the file.
@@ -402,11 +422,27 @@ void SoundFont::SetBackwardReferences() noexcept {
   for (const auto & instrument : instruments_) {
     instrument->set_parent_file(*this);
   }
+  IndexInstruments();
 
   // Set backward reference from samples to the file.
   for (const auto & sample : samples_) {
     sample->set_parent_file(*this);
   }
+  IndexSamples();
+}
+
+/// Renumbers the instruments after some of them have been removed.
+void SoundFont::IndexInstruments() noexcept {
+  for (size_t index = 0; index < instruments_.size(); index++) {
+    instruments_[index]->set_index(index);
+  }
+}
+
+/// Renumbers the samples after some of them have been removed.
+void SoundFont::IndexSamples() noexcept {
+  for (size_t index = 0; index < samples_.size(); index++) {
+    samples_[index]->set_index(index);
+  }
 }
 
 /// Repairs references in the copied children elements.
@@ -7,7 +7,6 @@
 
 #include <algorithm>
 #include <string>
-#include <unordered_map>
 #include <fstream>
 #include <stdexcept>
 
@@ -38,6 +37,11 @@ SoundFontWriter::SoundFontWriter(const SoundFont & file) :
     file_(&file) {
 }
 
+/// Returns the length of the file that Write produces.
+size_t SoundFontWriter::GetFileSize() {
+  return MakeRIFF().size();
+}
+
 /// Writes the SoundFont to a file.
 void SoundFontWriter::Write(const std::string & filename) {
   std::ofstream out;
@@ -50,11 +54,7 @@ void SoundFontWriter::Write(const std::string & filename) {
 
 /// Writes the SoundFont to an output stream.
 void SoundFontWriter::Write(std::ostream & out) {
-  RIFF riff("sfbk");
-  riff.AddChunk(MakeInfoListChunk());
-  riff.AddChunk(MakeSdtaListChunk());
-  riff.AddChunk(MakePdtaListChunk());
-  riff.Write(out);
+  MakeRIFF().Write(out);
 }
 
 /// Writes the SoundFont to an output stream.
@@ -62,6 +62,23 @@ void SoundFontWriter::Write(std::ostream && out) {
   Write(out);
 }
 
+/// Writes the SoundFont to a memory buffer.
+void SoundFontWriter::Write(std::vector<uint8_t> & data) {
+  RIFF riff = MakeRIFF();
+
+  data.resize(riff.size());
+  riff.Write(reinterpret_cast<char *>(data.data()));
+}
+
+/// Make the RIFF of the whole file.
+RIFF SoundFontWriter::MakeRIFF() {
+  RIFF riff("sfbk");
+  riff.AddChunk(MakeInfoListChunk());
+  riff.AddChunk(MakeSdtaListChunk());
+  riff.AddChunk(MakePdtaListChunk());
+  return riff;
+}
+
 /// Make an INFO chunk.
 std::unique_ptr<RIFFChunkInterface> SoundFontWriter::MakeInfoListChunk() {
   std::unique_ptr<RIFFListChunk> info = std::make_unique<RIFFListChunk>("INFO");
@@ -120,29 +137,17 @@ std::unique_ptr<RIFFChunkInterface> SoundFontWriter::MakeSdtaListChunk() {
 
 /// Make a pdta chunk.
 std::unique_ptr<RIFFChunkInterface> SoundFontWriter::MakePdtaListChunk() {
-  // Constructs a map for indexing each instruments.
-  std::unordered_map<const SFInstrument *, uint16_t> instrument_index_map;
-  for (uint16_t index = 0; index < file().instruments().size(); index++) {
-    instrument_index_map.insert(std::make_pair(file().instruments().at(index).get(), index));
-  }
-
-  // Constructs a map for indexing each samples.
-  std::unordered_map<const SFSample *, uint16_t> sample_index_map;
-  for (uint16_t index = 0; index < file().samples().size(); index++) {
-    sample_index_map.insert(std::make_pair(file().samples().at(index).get(), index));
-  }
-
   // Constructs the pdta chunk and its subchunks.
   std::unique_ptr<RIFFListChunk> pdta = std::make_unique<RIFFListChunk>("pdta");
   pdta->AddSubchunk(std::make_unique<SFRIFFPhdrChunk>(file().presets()));
   pdta->AddSubchunk(std::make_unique<SFRIFFPbagChunk>(file().presets()));
   pdta->AddSubchunk(std::make_unique<SFRIFFPmodChunk>(file().presets()));
-  pdta->AddSubchunk(std::make_unique<SFRIFFPgenChunk>(file().presets(), instrument_index_map));
+  pdta->AddSubchunk(std::make_unique<SFRIFFPgenChunk>(file().presets(), file().instruments()));
   pdta->AddSubchunk(std::make_unique<SFRIFFInstChunk>(file().instruments()));
   pdta->AddSubchunk(std::make_unique<SFRIFFIbagChunk>(file().instruments()));
   pdta->AddSubchunk(std::make_unique<SFRIFFImodChunk>(file().instruments()));
-  pdta->AddSubchunk(std::make_unique<SFRIFFIgenChunk>(file().instruments(), sample_index_map));
-  pdta->AddSubchunk(std::make_unique<SFRIFFShdrChunk>(file().samples(), sample_index_map));
+  pdta->AddSubchunk(std::make_unique<SFRIFFIgenChunk>(file().instruments(), file().samples()));
+  pdta->AddSubchunk(std::make_unique<SFRIFFShdrChunk>(file().samples()));
   return std::move(pdta);
 }
 
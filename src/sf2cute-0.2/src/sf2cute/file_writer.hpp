@@ -6,9 +6,12 @@
 #ifndef SF2CUTE_FILE_WRITER_HPP_
 #define SF2CUTE_FILE_WRITER_HPP_
 
+#include <stdint.h>
+#include <stddef.h>
 #include <algorithm>
 #include <memory>
 #include <string>
+#include <vector>
 #include <ostream>
 
 #include <sf2cute/types.hpp>
@@ -24,6 +27,7 @@ class SFPreset;
 class SoundFont;
 
 class RIFFChunkInterface;
+class RIFF;
 
 /// The SoundFontWriter class represents a SoundFont writer.
 class SoundFontWriter {
@@ -66,6 +70,10 @@ public:
     file_ = &file;
   }
 
+  /// Returns the length of the file that Write produces.
+  /// @return the length of the SoundFont file, in terms of bytes.
+  size_t GetFileSize();
+
   /// Writes the SoundFont to a file.
   /// @param filename the name of the file to write to.
   void Write(const std::string & filename);
@@ -77,7 +85,20 @@ public:
   /// @copydoc SoundFontWriter::Write(std::ostream &)
   void Write(std::ostream && out);
 
+  /// Writes the SoundFont to a memory buffer.
+  ///
+  /// The length of every chunk is known before anything is written, so the
+  /// buffer is sized once and filled in place.
+  ///
+  /// @param data the buffer to write to, resized to the exact length of the file.
+  /// @throws std::logic_error The SoundFont has a structural error.
+  void Write(std::vector<uint8_t> & data);
+
 private:
+  /// Make the RIFF of the whole file.
+  /// @return the RIFF of the whole file.
+  RIFF MakeRIFF();
+
   /// Make an INFO chunk.
   /// @return the INFO chunk.
   std::unique_ptr<RIFFChunkInterface> MakeInfoListChunk();
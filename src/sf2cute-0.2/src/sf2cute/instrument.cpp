@@ -19,13 +19,15 @@ namespace sf2cute {
 
 /// Constructs a new empty instrument.
 SFInstrument::SFInstrument() :
-    parent_file_(nullptr) {
+    parent_file_(nullptr),
+    index_(0) {
 }
 
 /// Constructs a new empty SFInstrument using the specified name.
 SFInstrument::SFInstrument(std::string name) :
     name_(std::move(name)),
-    parent_file_(nullptr) {
+    parent_file_(nullptr),
+    index_(0) {
 }
 
 /// Constructs a new SFInstrument using the specified name and zones.
@@ -34,7 +36,8 @@ SFInstrument::SFInstrument(std::string name,
     name_(std::move(name)),
     zones_(),
     global_zone_(nullptr),
-    parent_file_(nullptr) {
+    parent_file_(nullptr),
+    index_(0) {
   // Set instrument zones.
   zones_.reserve(zones.size());
   for (auto && zone : zones) {
@@ -52,7 +55,8 @@ SFInstrument::SFInstrument(std::string name,
     name_(std::move(name)),
     zones_(),
     global_zone_(std::make_unique<SFInstrumentZone>(std::move(global_zone))),
-    parent_file_(nullptr) {
+    parent_file_(nullptr),
+    index_(0) {
   // Set instrument zones.
   zones_.reserve(zones.size());
   for (auto && zone : zones) {
@@ -68,7 +72,8 @@ SFInstrument::SFInstrument(const SFInstrument & origin) :
     name_(origin.name_),
     zones_(),
     global_zone_(nullptr),
-    parent_file_(nullptr) {
+    parent_file_(nullptr),
+    index_(0) {
   // Copy global zone.
   if (origin.has_global_zone()) {
     global_zone_ = std::make_unique<SFInstrumentZone>(origin.global_zone());
@@ -102,6 +107,7 @@ SFInstrument & SFInstrument::operator=(const SFInstrument & origin) {
   // Copy other fields.
   name_ = origin.name_;
   parent_file_ = nullptr;
+  index_ = 0;
 
   // Repair references.
   SetBackwardReferences();
@@ -114,7 +120,8 @@ SFInstrument::SFInstrument(SFInstrument && origin) noexcept :
     name_(std::move(origin.name_)),
     zones_(std::move(origin.zones_)),
     global_zone_(std::move(origin.global_zone_)),
-    parent_file_(nullptr) {
+    parent_file_(nullptr),
+    index_(0) {
   SetBackwardReferences();
 }
 
@@ -125,6 +132,7 @@ SFInstrument & SFInstrument::operator=(SFInstrument && origin) noexcept {
   zones_ = std::move(origin.zones_);
   global_zone_ = std::move(origin.global_zone_);
   parent_file_ = nullptr;
+  index_ = 0;
 
   // Repair references.
   SetBackwardReferences();
@@ -8,6 +8,7 @@
 #include "riff.hpp"
 
 #include <stdint.h>
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <vector>
@@ -19,6 +20,16 @@
 
 namespace sf2cute {
 
+/// Writes this chunk to the specified output stream.
+void RIFFChunkInterface::Write(std::ostream & out) const {
+  // Lay out the chunk in memory.
+  std::vector<char> data(size());
+  Write(data.data());
+
+  // Write the chunk at once.
+  out.write(data.data(), static_cast<std::streamsize>(data.size()));
+}
+
 /// Constructs a new empty RIFFChunk.
 RIFFChunk::RIFFChunk() :
     name_("    ") {
@@ -48,36 +59,40 @@ void RIFFChunk::set_name(std::string name) {
   name_ = std::move(name);
 }
 
-/// Writes this chunk to the specified output stream.
-void RIFFChunk::Write(std::ostream & out) const {
-  // Save exception bits of output stream.
-  const std::ios_base::iostate old_exception_bits = out.exceptions();
-  // Set exception bits to get output error as an exception.
-  out.exceptions(std::ios::badbit | std::ios::failbit);
-
-  try {
-    // Write the chunk header.
-    WriteHeader(out, name(), data_.size());
+/// Writes this chunk to the specified buffer.
+char * RIFFChunk::Write(char * out) const {
+  // Write the chunk header.
+  out = WriteHeader(out, name(), data_.size());
 
-    // Write the chunk data.
-    out.write(reinterpret_cast<const char *>(data_.data()), data_.size());
+  // Write the chunk data.
+  out = std::copy(data_.begin(), data_.end(), out);
 
-    // Write a padding byte if necessary.
-    if (data_.size() % 2 != 0) {
-      InsertInt8(out, 0);
-    }
+  // Write a padding byte if necessary.
+  if (data_.size() % 2 != 0) {
+    out = WriteInt8(out, 0);
   }
-  catch (const std::exception &) {
-    // Recover exception bits of output stream.
-    out.exceptions(old_exception_bits);
 
-    // Rethrow the exception.
-    throw;
+  return out;
+}
+
+/// Writes this chunk to the specified output stream.
+void RIFFChunk::Write(std::ostream & out) const {
+  // Write the chunk header.
+  char header[8];
+  WriteHeader(header, name(), data_.size());
+  out.write(header, sizeof(header));
+
+  // Write the chunk data.
+  out.write(data_.data(), static_cast<std::streamsize>(data_.size()));
+
+  // Write a padding byte if necessary.
+  if (data_.size() % 2 != 0) {
+    InsertInt8(out, 0);
   }
 }
 
-/// Writes a chunk header to the specified output stream.
-void RIFFChunk::WriteHeader(std::ostream & out,
+/// Writes a chunk header to the specified buffer.
+char * RIFFChunk::WriteHeader(char * out,
     const std::string & name,
     size_type size) {
   // Throw exception if the chunk size exceeds the maximum.
@@ -87,25 +102,11 @@ void RIFFChunk::WriteHeader(std::ostream & out,
     throw std::length_error(message_builder.str());
   }
 
-  // Save exception bits of output stream.
-  const std::ios_base::iostate old_exception_bits = out.exceptions();
-  // Set exception bits to get output error as an exception.
-  out.exceptions(std::ios::badbit | std::ios::failbit);
-
-  try {
-    // Write the chunk name.
-    out.write(name.data(), name.size());
-
-    // Write the chunk size.
-    InsertInt32L(out, static_cast<uint32_t>(size));
-  }
-  catch (const std::exception &) {
-    // Recover exception bits of output stream.
-    out.exceptions(old_exception_bits);
+  // Write the chunk name.
+  out = std::copy(name.begin(), name.end(), out);
 
-    // Rethrow the exception.
-    throw;
-  }
+  // Write the chunk size.
+  return WriteInt32L(out, static_cast<uint32_t>(size));
 }
 
 /// Constructs a new empty RIFFListChunk.
@@ -141,10 +142,25 @@ void RIFFListChunk::ClearSubchunks() {
   subchunks_.clear();
 }
 
+/// Writes this chunk to the specified buffer.
+char * RIFFListChunk::Write(char * out) const {
+  // Write the chunk header.
+  out = WriteHeader(out, name(), size() - 8);
+
+  // Write each subchunks.
+  for (const auto & subchunk : subchunks_) {
+    out = subchunk->Write(out);
+  }
+
+  return out;
+}
+
 /// Writes this chunk to the specified output stream.
 void RIFFListChunk::Write(std::ostream & out) const {
   // Write the chunk header.
-  WriteHeader(out, name(), size() - 8);
+  char header[12];
+  WriteHeader(header, name(), size() - 8);
+  out.write(header, sizeof(header));
 
   // Write each subchunks.
   for (const auto & subchunk : subchunks_) {
@@ -152,8 +168,8 @@ void RIFFListChunk::Write(std::ostream & out) const {
   }
 }
 
-/// Writes a "LIST" chunk header to the specified output stream.
-void RIFFListChunk::WriteHeader(std::ostream & out,
+/// Writes a "LIST" chunk header to the specified buffer.
+char * RIFFListChunk::WriteHeader(char * out,
     const std::string & name,
     size_type size) {
   // Throw exception if the chunk size exceeds the maximum.
@@ -163,28 +179,14 @@ void RIFFListChunk::WriteHeader(std::ostream & out,
     throw std::length_error(message_builder.str());
   }
 
-  // Save exception bits of output stream.
-  const std::ios_base::iostate old_exception_bits = out.exceptions();
-  // Set exception bits to get output error as an exception.
-  out.exceptions(std::ios::badbit | std::ios::failbit);
-
-  try {
-    // Write the chunk ID "LIST".
-    out.write("LIST", 4);
+  // Write the chunk ID "LIST".
+  out = std::copy_n("LIST", 4, out);
 
-    // Write the chunk size.
-    InsertInt32L(out, static_cast<uint32_t>(size));
-
-    // Write the list type.
-    out.write(name.data(), name.size());
-  }
-  catch (const std::exception &) {
-    // Recover exception bits of output stream.
-    out.exceptions(old_exception_bits);
+  // Write the chunk size.
+  out = WriteInt32L(out, static_cast<uint32_t>(size));
 
-    // Rethrow the exception.
-    throw;
-  }
+  // Write the list type.
+  return std::copy(name.begin(), name.end(), out);
 }
 
 /// Constructs a new empty RIFF.
@@ -219,7 +221,9 @@ void RIFF::Write(std::ostream & out) const {
 
   try {
     // Write the RIFF header.
-    WriteHeader(out, name(), size() - 8);
+    char header[12];
+    WriteHeader(header, name(), size() - 8);
+    out.write(header, sizeof(header));
 
     // Write each chunks.
     for (const auto & chunk : chunks_) {
@@ -235,8 +239,21 @@ void RIFF::Write(std::ostream & out) const {
   }
 }
 
-/// Writes a "RIFF" chunk header to the specified output stream.
-void RIFF::WriteHeader(std::ostream & out,
+/// Writes this RIFF to the specified buffer.
+char * RIFF::Write(char * out) const {
+  // Write the RIFF header.
+  out = WriteHeader(out, name(), size() - 8);
+
+  // Write each chunks.
+  for (const auto & chunk : chunks_) {
+    out = chunk->Write(out);
+  }
+
+  return out;
+}
+
+/// Writes a "RIFF" chunk header to the specified buffer.
+char * RIFF::WriteHeader(char * out,
     const std::string & name,
     size_type size) {
   // Throw exception if the RIFF file size exceeds the maximum.
@@ -244,28 +261,14 @@ void RIFF::WriteHeader(std::ostream & out,
     throw std::length_error("RIFF file size too large.");
   }
 
-  // Save exception bits of output stream.
-  const std::ios_base::iostate old_exception_bits = out.exceptions();
-  // Set exception bits to get output error as an exception.
-  out.exceptions(std::ios::badbit | std::ios::failbit);
-
-  try {
-    // Write the ID "RIFF".
-    out.write("RIFF", 4);
-
-    // Write the file size.
-    InsertInt32L(out, static_cast<uint32_t>(size));
+  // Write the ID "RIFF".
+  out = std::copy_n("RIFF", 4, out);
 
-    // Write the form type.
-    out.write(name.data(), name.size());
-  }
-  catch (const std::exception &) {
-    // Recover exception bits of output stream.
-    out.exceptions(old_exception_bits);
+  // Write the file size.
+  out = WriteInt32L(out, static_cast<uint32_t>(size));
 
-    // Rethrow the exception.
-    throw;
-  }
+  // Write the form type.
+  return std::copy(name.begin(), name.end(), out);
 }
 
 } // namespace sf2cute
@@ -33,11 +33,21 @@ public:
   /// @return the length of this chunk including a chunk header, in terms of bytes.
   virtual size_type size() const noexcept = 0;
 
+  /// Writes this chunk to the specified buffer.
+  /// @param out the output buffer, which must have room for size() bytes.
+  /// @return the position following the written chunk.
+  /// @throws std::length_error The chunk size exceeds the maximum.
+  virtual char * Write(char * out) const = 0;
+
   /// Writes this chunk to the specified output stream.
+  ///
+  /// By default the chunk is laid out in memory and written at once, which
+  /// suits small chunks. Chunks that hold bulk data write it piece by piece.
+  ///
   /// @param out the output stream.
   /// @throws std::length_error The chunk size exceeds the maximum.
   /// @throws std::ios_base::failure An I/O error occurred.
-  virtual void Write(std::ostream & out) const = 0;
+  virtual void Write(std::ostream & out) const;
 };
 
 /// The RIFFChunk class represents a RIFF chunk.
@@ -111,19 +121,25 @@ public:
     return 8 + chunk_size;
   }
 
+  /// Writes this chunk to the specified buffer.
+  /// @param out the output buffer, which must have room for size() bytes.
+  /// @return the position following the written chunk.
+  /// @throws std::length_error The chunk size exceeds the maximum.
+  virtual char * Write(char * out) const override;
+
   /// Writes this chunk to the specified output stream.
   /// @param out the output stream.
   /// @throws std::length_error The chunk size exceeds the maximum.
   /// @throws std::ios_base::failure An I/O error occurred.
   virtual void Write(std::ostream & out) const override;
 
-  /// Writes a chunk header to the specified output stream.
-  /// @param out the output stream.
+  /// Writes a chunk header to the specified buffer.
+  /// @param out the output buffer.
   /// @param name the name of the chunk (FourCC).
   /// @param size the length of the chunk data, in terms of bytes.
+  /// @return the position following the written header.
   /// @throws std::length_error The chunk size exceeds the maximum.
-  /// @throws std::ios_base::failure An I/O error occurred.
-  static void WriteHeader(std::ostream & out,
+  static char * WriteHeader(char * out,
       const std::string & name,
       size_type size);
 
@@ -203,19 +219,29 @@ public:
     return 12 + chunk_size;
   }
 
+  /// Writes this chunk to the specified buffer.
+  /// @param out the output buffer, which must have room for size() bytes.
+  /// @return the position following the written chunk.
+  /// @throws std::length_error The chunk size exceeds the maximum.
+  virtual char * Write(char * out) const override;
+
   /// Writes this chunk to the specified output stream.
+  ///
+  /// Each subchunk is written in turn, so the list is never laid out in
+  /// memory as a whole.
+  ///
   /// @param out the output stream.
   /// @throws std::length_error The chunk size exceeds the maximum.
   /// @throws std::ios_base::failure An I/O error occurred.
   virtual void Write(std::ostream & out) const override;
 
-  /// Writes a "LIST" chunk header to the specified output stream.
-  /// @param out the output stream.
+  /// Writes a "LIST" chunk header to the specified buffer.
+  /// @param out the output buffer.
   /// @param name the list type of the chunk (FourCC).
   /// @param size the length of the chunk data, in terms of bytes.
+  /// @return the position following the written header.
   /// @throws std::length_error The chunk size exceeds the maximum.
-  /// @throws std::ios_base::failure An I/O error occurred.
-  static void WriteHeader(std::ostream & out,
+  static char * WriteHeader(char * out,
       const std::string & name,
       size_type size);
 
@@ -299,18 +325,28 @@ public:
   }
 
   /// Writes this RIFF to the specified output stream.
+  ///
+  /// The chunks are written one after another, so the RIFF is never laid
+  /// out in memory as a whole.
+  ///
   /// @param out the output stream.
   /// @throws std::length_error The chunk size exceeds the maximum.
   /// @throws std::ios_base::failure An I/O error occurred.
   void Write(std::ostream & out) const;
 
-  /// Writes a "RIFF" chunk header to the specified output stream.
-  /// @param out the output stream.
+  /// Writes this RIFF to the specified buffer.
+  /// @param out the output buffer, which must have room for size() bytes.
+  /// @return the position following the written RIFF.
+  /// @throws std::length_error The chunk size exceeds the maximum.
+  char * Write(char * out) const;
+
+  /// Writes a "RIFF" chunk header to the specified buffer.
+  /// @param out the output buffer.
   /// @param name the form type of the chunk (FourCC).
   /// @param size the length of the chunk data, in terms of bytes.
+  /// @return the position following the written header.
   /// @throws std::length_error The chunk size exceeds the maximum.
-  /// @throws std::ios_base::failure An I/O error occurred.
-  static void WriteHeader(std::ostream & out,
+  static char * WriteHeader(char * out,
       const std::string & name,
       size_type size);
 
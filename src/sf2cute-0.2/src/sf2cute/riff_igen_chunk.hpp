@@ -10,8 +10,6 @@
 #include <memory>
 #include <string>
 #include <vector>
-#include <unordered_map>
-#include <ostream>
 
 #include <sf2cute/types.hpp>
 
@@ -21,7 +19,6 @@ namespace sf2cute {
 
 class SFInstrument;
 class SFSample;
-class SFGeneratorItem;
 
 /// The SFRIFFIgenChunk class represents a SoundFont 2 "igen" chunk.
 class SFRIFFIgenChunk : public RIFFChunkInterface {
@@ -37,11 +34,11 @@ public:
 
   /// Constructs a new SFRIFFIgenChunk using the specified instruments.
   /// @param instruments The instruments of the chunk.
-  /// @param sample_index_map the map containing the samples as keys and their indices as map values.
+  /// @param samples the samples referenced by the zones, each at its own index.
   /// @throws std::length_error Too many instrument generators.
   SFRIFFIgenChunk(
       const std::vector<std::shared_ptr<SFInstrument>> & instruments,
-      std::unordered_map<const SFSample *, uint16_t> sample_index_map);
+      const std::vector<std::shared_ptr<SFSample>> & samples);
 
   /// Constructs a new copy of specified SFRIFFIgenChunk.
   /// @param origin a SFRIFFIgenChunk object.
@@ -83,18 +80,18 @@ public:
     size_ = kItemSize * NumItems();
   }
 
-  /// Returns the map containing the samples as keys and their indices as map values.
-  /// @return the map containing the samples as keys and their indices as map values.
-  const std::unordered_map<const SFSample *, uint16_t> &
-      sample_index_map() const {
-    return sample_index_map_;
+  /// Returns the samples referenced by this chunk.
+  /// @return the samples referenced by this chunk.
+  const std::vector<std::shared_ptr<SFSample>> &
+      samples() const {
+    return *samples_;
   }
 
-  /// Sets the map containing the samples as keys and their indices as map values.
-  /// @param sample_index_map the map containing the samples as keys and their indices as map values.
-  void set_sample_index_map(
-      std::unordered_map<const SFSample *, uint16_t> sample_index_map) {
-    sample_index_map_ = std::move(sample_index_map);
+  /// Sets the samples referenced by this chunk.
+  /// @param samples the samples referenced by this chunk.
+  void set_samples(
+      const std::vector<std::shared_ptr<SFSample>> & samples) {
+    samples_ = &samples;
   }
 
   /// Returns the whole length of this chunk.
@@ -103,14 +100,14 @@ public:
     return 8 + size_;
   }
 
-  /// Writes this chunk to the specified output stream.
-  /// @param out the output stream.
+  /// Writes this chunk to the specified buffer.
+  /// @param out the output buffer, which must have room for size() bytes.
+  /// @return the position following the written chunk.
   /// @throws std::invalid_argument Global instrument zone has a sample.
   /// @throws std::invalid_argument Instrument zone does not have a sample.
   /// @throws std::length_error The chunk size exceeds the maximum.
   /// @throws std::out_of_range Instrument zone points to an unknown sample.
-  /// @throws std::ios_base::failure An I/O error occurred.
-  virtual void Write(std::ostream & out) const override;
+  virtual char * Write(char * out) const override;
 
 private:
   /// Returns the number of instrument generator items.
@@ -119,29 +116,22 @@ private:
   uint16_t NumItems() const;
 
   /// Writes an item of igen chunk.
-  /// @param out the output stream.
+  /// @param out the output buffer.
   /// @param op the type of the generator.
   /// @param amount the amount of the generator.
-  /// @return the output stream.
-  /// @throws std::ios_base::failure An I/O error occurred.
-  static std::ostream & WriteItem(std::ostream & out,
+  /// @return the position following the written item.
+  static char * WriteItem(char * out,
       SFGenerator op,
       GenAmountType amount);
 
-  /// Sort generators based on the ordering requirements of the generator chunk.
-  /// @param generators the generators.
-  /// @return the sorted collection of the generator pointers.
-  static std::vector<SFGeneratorItem *> SortGenerators(
-      const std::vector<std::unique_ptr<SFGeneratorItem>> & generators);
-
   /// The size of the chunk (excluding header).
   size_type size_;
 
   /// The instruments of the chunk.
   const std::vector<std::shared_ptr<SFInstrument>> * instruments_;
 
-  /// The map containing the samples as keys and their indices as map values.
-  std::unordered_map<const SFSample *, uint16_t> sample_index_map_;
+  /// The samples referenced by the chunk.
+  const std::vector<std::shared_ptr<SFSample>> * samples_;
 };
 
 } // namespace sf2cute
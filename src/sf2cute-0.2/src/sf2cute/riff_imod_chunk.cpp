@@ -9,7 +9,6 @@
 #include <memory>
 #include <string>
 #include <sstream>
-#include <ostream>
 #include <stdexcept>
 
 #include <sf2cute/instrument.hpp>
@@ -32,53 +31,41 @@ SFRIFFImodChunk::SFRIFFImodChunk(
   size_ = kItemSize * NumItems();
 }
 
-/// Writes this chunk to the specified output stream.
-void SFRIFFImodChunk::Write(std::ostream & out) const {
-  // Save exception bits of output stream.
-  const std::ios_base::iostate old_exception_bits = out.exceptions();
-  // Set exception bits to get output error as an exception.
-  out.exceptions(std::ios::badbit | std::ios::failbit);
-
-  try {
-    // Write the chunk header.
-    RIFFChunk::WriteHeader(out, name(), size_);
-
-    // Instruments:
-    for (const auto & instrument : instruments()) {
-      // Global zone:
-      if (instrument->has_global_zone()) {
-        // Write all the modulators in the global zone.
-        for (const auto & modulator : instrument->global_zone().modulators()) {
-          WriteItem(out, modulator->source_op(), modulator->destination_op(),
-            modulator->amount(), modulator->amount_source_op(), modulator->transform_op());
-        }
-      }
+/// Writes this chunk to the specified buffer.
+char * SFRIFFImodChunk::Write(char * out) const {
+  // Write the chunk header.
+  out = RIFFChunk::WriteHeader(out, name(), size_);
 
-      // Instrument zones:
-      for (const auto & zone : instrument->zones()) {
-        // Write all the modulators in the instrument zone.
-        for (const auto & modulator : zone->modulators()) {
-          WriteItem(out, modulator->source_op(), modulator->destination_op(),
-            modulator->amount(), modulator->amount_source_op(), modulator->transform_op());
-        }
+  // Instruments:
+  for (const auto & instrument : instruments()) {
+    // Global zone:
+    if (instrument->has_global_zone()) {
+      // Write all the modulators in the global zone.
+      for (const auto & modulator : instrument->global_zone().modulators()) {
+        out = WriteItem(out, modulator->source_op(), modulator->destination_op(),
+          modulator->amount(), modulator->amount_source_op(), modulator->transform_op());
       }
     }
 
-    // Write the last terminator item.
-    WriteItem(out, SFModulator(0), SFGenerator(0), 0, SFModulator(0), SFTransform(0));
-
-    // Write a padding byte if necessary.
-    if (size_ % 2 != 0) {
-      InsertInt8(out, 0);
+    // Instrument zones:
+    for (const auto & zone : instrument->zones()) {
+      // Write all the modulators in the instrument zone.
+      for (const auto & modulator : zone->modulators()) {
+        out = WriteItem(out, modulator->source_op(), modulator->destination_op(),
+          modulator->amount(), modulator->amount_source_op(), modulator->transform_op());
+      }
     }
   }
-  catch (const std::exception &) {
-    // Recover exception bits of output stream.
-    out.exceptions(old_exception_bits);
 
-    // Rethrow the exception.
-    throw;
+  // Write the last terminator item.
+  out = WriteItem(out, SFModulator(0), SFGenerator(0), 0, SFModulator(0), SFTransform(0));
+
+  // Write a padding byte if necessary.
+  if (size_ % 2 != 0) {
+    out = WriteInt8(out, 0);
   }
+
+  return out;
 }
 
 /// Returns the number of instrument modulator items.
@@ -105,7 +92,7 @@ uint16_t SFRIFFImodChunk::NumItems() const {
 }
 
 /// Writes an item of imod chunk.
-std::ostream & SFRIFFImodChunk::WriteItem(std::ostream & out,
+char * SFRIFFImodChunk::WriteItem(char * out,
     SFModulator source_op,
     SFGenerator destination_op,
     int16_t amount,
@@ -113,19 +100,19 @@ std::ostream & SFRIFFImodChunk::WriteItem(std::ostream & out,
     SFTransform transform_op) {
   // struct sfInstModList:
   // SFModulator sfModSrcOper;
-  InsertInt16L(out, uint16_t(source_op));
+  out = WriteInt16L(out, uint16_t(source_op));
 
   // SFGenerator sfModDestOper;
-  InsertInt16L(out, uint16_t(destination_op));
+  out = WriteInt16L(out, uint16_t(destination_op));
 
   // int16_t modAmount;
-  InsertInt16L(out, amount);
+  out = WriteInt16L(out, amount);
 
   // SFModulator sfModAmtSrcOper;
-  InsertInt16L(out, uint16_t(amount_source_op));
+  out = WriteInt16L(out, uint16_t(amount_source_op));
 
   // SFTransform sfModTransOper;
-  InsertInt16L(out, uint16_t(transform_op));
+  out = WriteInt16L(out, uint16_t(transform_op));
 
   return out;
 }
@@ -10,8 +10,6 @@
 #include <memory>
 #include <string>
 #include <vector>
-#include <unordered_map>
-#include <ostream>
 
 #include <sf2cute/types.hpp>
 
@@ -21,7 +19,6 @@ namespace sf2cute {
 
 class SFPreset;
 class SFInstrument;
-class SFGeneratorItem;
 
 /// The SFRIFFPgenChunk class represents a SoundFont 2 "pgen" chunk.
 class SFRIFFPgenChunk : public RIFFChunkInterface {
@@ -37,11 +34,11 @@ public:
 
   /// Constructs a new SFRIFFPgenChunk using the specified presets.
   /// @param presets the presets of the chunk.
-  /// @param instrument_index_map map containing the instruments as keys and their indices as map values.
+  /// @param instruments the instruments referenced by the zones, each at its own index.
   /// @throws std::length_error Too many preset generators.
   SFRIFFPgenChunk(
       const std::vector<std::shared_ptr<SFPreset>> & presets,
-      std::unordered_map<const SFInstrument *, uint16_t> instrument_index_map);
+      const std::vector<std::shared_ptr<SFInstrument>> & instruments);
 
   /// Constructs a new copy of specified SFRIFFPgenChunk.
   /// @param origin a SFRIFFPgenChunk object.
@@ -83,18 +80,18 @@ public:
     size_ = kItemSize * NumItems();
   }
 
-  /// Returns the map containing the instruments as keys and their indices as map values.
-  /// @return the map containing the instruments as keys and their indices as map values.
-  const std::unordered_map<const SFInstrument *, uint16_t> &
-      instrument_index_map() const {
-    return instrument_index_map_;
+  /// Returns the instruments referenced by this chunk.
+  /// @return the instruments referenced by this chunk.
+  const std::vector<std::shared_ptr<SFInstrument>> &
+      instruments() const {
+    return *instruments_;
   }
 
-  /// Sets the map containing the instruments as keys and their indices as map values.
-  /// @param instrument_index_map the map containing the instruments as keys and their indices as map values.
-  void set_instrument_index_map(
-      std::unordered_map<const SFInstrument *, uint16_t> instrument_index_map) {
-    instrument_index_map_ = std::move(instrument_index_map);
+  /// Sets the instruments referenced by this chunk.
+  /// @param instruments the instruments referenced by this chunk.
+  void set_instruments(
+      const std::vector<std::shared_ptr<SFInstrument>> & instruments) {
+    instruments_ = &instruments;
   }
 
   /// Returns the whole length of this chunk.
@@ -103,14 +100,14 @@ public:
     return 8 + size_;
   }
 
-  /// Writes this chunk to the specified output stream.
-  /// @param out the output stream.
+  /// Writes this chunk to the specified buffer.
+  /// @param out the output buffer, which must have room for size() bytes.
+  /// @return the position following the written chunk.
   /// @throws std::invalid_argument Global preset zone has an instrument.
   /// @throws std::invalid_argument Instrument zone does not have an instrument.
   /// @throws std::length_error The chunk size exceeds the maximum.
   /// @throws std::out_of_range Preset zone points to an unknown instrument.
-  /// @throws std::ios_base::failure An I/O error occurred.
-  virtual void Write(std::ostream & out) const override;
+  virtual char * Write(char * out) const override;
 
 private:
   /// Returns the number of preset generator items.
@@ -119,29 +116,22 @@ private:
   uint16_t NumItems() const;
 
   /// Writes an item of pgen chunk.
-  /// @param out the output stream.
+  /// @param out the output buffer.
   /// @param op the type of the generator.
   /// @param amount the amount of the generator.
-  /// @return the output stream.
-  /// @throws std::ios_base::failure An I/O error occurred.
-  static std::ostream & WriteItem(std::ostream & out,
+  /// @return the position following the written item.
+  static char * WriteItem(char * out,
       SFGenerator op,
       GenAmountType amount);
 
-  /// Sort generators based on the ordering requirements of the generator chunk.
-  /// @param generators the generators.
-  /// @return the sorted collection of the generator pointers.
-  static std::vector<SFGeneratorItem *> SortGenerators(
-      const std::vector<std::unique_ptr<SFGeneratorItem>> & generators);
-
   /// The size of the chunk (excluding header).
   size_type size_;
 
   /// The presets of the chunk.
   const std::vector<std::shared_ptr<SFPreset>> * presets_;
 
-  /// The map containing the instruments as keys and their indices as map values.
-  std::unordered_map<const SFInstrument *, uint16_t> instrument_index_map_;
+  /// The instruments referenced by the chunk.
+  const std::vector<std::shared_ptr<SFInstrument>> * instruments_;
 };
 
 } // namespace sf2cute
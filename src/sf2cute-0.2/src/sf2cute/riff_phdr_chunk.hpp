@@ -10,7 +10,6 @@
 #include <memory>
 #include <string>
 #include <vector>
-#include <ostream>
 
 #include "riff.hpp"
 
@@ -82,11 +81,11 @@ public:
     return 8 + size_;
   }
 
-  /// Writes this chunk to the specified output stream.
-  /// @param out the output stream.
+  /// Writes this chunk to the specified buffer.
+  /// @param out the output buffer, which must have room for size() bytes.
+  /// @return the position following the written chunk.
   /// @throws std::length_error The chunk size exceeds the maximum.
-  /// @throws std::ios_base::failure An I/O error occurred.
-  virtual void Write(std::ostream & out) const override;
+  virtual char * Write(char * out) const override;
 
 private:
   /// Returns the number of preset items.
@@ -95,7 +94,7 @@ private:
   uint16_t NumItems() const;
 
   /// Writes an item of phdr chunk.
-  /// @param out the output stream.
+  /// @param out the output buffer.
   /// @param name the name of preset.
   /// @param preset_number the preset number.
   /// @param bank the bank number.
@@ -103,9 +102,8 @@ private:
   /// @param library the library.
   /// @param genre the genre.
   /// @param morphology the morphology.
-  /// @return the output stream.
-  /// @throws std::ios_base::failure An I/O error occurred.
-  static std::ostream & WriteItem(std::ostream & out,
+  /// @return the position following the written item.
+  static char * WriteItem(char * out,
       const std::string & name,
       uint16_t preset_number,
       uint16_t bank,
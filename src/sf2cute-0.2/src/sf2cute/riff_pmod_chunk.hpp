@@ -10,7 +10,6 @@
 #include <memory>
 #include <string>
 #include <vector>
-#include <ostream>
 
 #include <sf2cute/types.hpp>
 #include <sf2cute/modulator.hpp>
@@ -85,11 +84,11 @@ public:
     return 8 + size_;
   }
 
-  /// Writes this chunk to the specified output stream.
-  /// @param out the output stream.
+  /// Writes this chunk to the specified buffer.
+  /// @param out the output buffer, which must have room for size() bytes.
+  /// @return the position following the written chunk.
   /// @throws std::length_error The chunk size exceeds the maximum.
-  /// @throws std::ios_base::failure An I/O error occurred.
-  virtual void Write(std::ostream & out) const override;
+  virtual char * Write(char * out) const override;
 
 private:
   /// Returns the number of preset modulator items.
@@ -98,15 +97,14 @@ private:
   uint16_t NumItems() const;
 
   /// Writes an item of pmod chunk.
-  /// @param out the output stream.
+  /// @param out the output buffer.
   /// @param source_op the source of data for the modulator.
   /// @param destination_op the destination of the modulator.
   /// @param amount the degree to which the source modulates the destination.
   /// @param amount_source_op the modulation source to be applied to the modulation amount.
   /// @param transform_op the transform type to be applied to the modulation source.
-  /// @return the output stream.
-  /// @throws std::ios_base::failure An I/O error occurred.
-  static std::ostream & WriteItem(std::ostream & out,
+  /// @return the position following the written item.
+  static char * WriteItem(char * out,
       SFModulator source_op,
       SFGenerator destination_op,
       int16_t amount,
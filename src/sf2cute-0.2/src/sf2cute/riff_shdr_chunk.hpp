@@ -10,8 +10,6 @@
 #include <memory>
 #include <string>
 #include <vector>
-#include <unordered_map>
-#include <ostream>
 
 #include <sf2cute/types.hpp>
 #include <sf2cute/modulator.hpp>
@@ -36,10 +34,8 @@ public:
 
   /// Constructs a new SFRIFFShdrChunk using the specified samples.
   /// @param samples The samples of the chunk.
-  /// @param sample_index_map the map containing the samples as keys and their indices as map values.
   /// @throws std::length_error Too many samples.
-  SFRIFFShdrChunk(const std::vector<std::shared_ptr<SFSample>> & samples,
-      std::unordered_map<const SFSample *, uint16_t> sample_index_map);
+  SFRIFFShdrChunk(const std::vector<std::shared_ptr<SFSample>> & samples);
 
   /// Constructs a new copy of specified SFRIFFShdrChunk.
   /// @param origin a SFRIFFShdrChunk object.
@@ -79,30 +75,18 @@ public:
     size_ = kItemSize * NumItems();
   }
 
-  /// Returns the map containing the samples as keys and their indices as map values.
-  /// @return the map containing the samples as keys and their indices as map values.
-  const std::unordered_map<const SFSample *, uint16_t> & sample_index_map() const {
-    return sample_index_map_;
-  }
-
-  /// Sets the map containing the samples as keys and their indices as map values.
-  /// @param sample_index_map the map containing the samples as keys and their indices as map values.
-  void set_sample_index_map(std::unordered_map<const SFSample *, uint16_t> sample_index_map) {
-    sample_index_map_ = std::move(sample_index_map);
-  }
-
   /// Returns the whole length of this chunk.
   /// @return the length of this chunk including a chunk header, in terms of bytes.
   virtual size_type size() const noexcept override {
     return 8 + size_;
   }
 
-  /// Writes this chunk to the specified output stream.
-  /// @param out the output stream.
+  /// Writes this chunk to the specified buffer.
+  /// @param out the output buffer, which must have room for size() bytes.
+  /// @return the position following the written chunk.
   /// @throws std::length_error The chunk size exceeds the maximum.
   /// @throws std::out_of_range Sample has a link to an unknown sample.
-  /// @throws std::ios_base::failure An I/O error occurred.
-  virtual void Write(std::ostream & out) const override;
+  virtual char * Write(char * out) const override;
 
 private:
   /// Returns the number of sample header items.
@@ -111,7 +95,7 @@ private:
   uint16_t NumItems() const;
 
   /// Writes an item of shdr chunk.
-  /// @param out the output stream.
+  /// @param out the output buffer.
   /// @param name the name of sample.
   /// @param start the beginning index of the sample, in sample data points, inclusive.
   /// @param end the ending index of the sample, in sample data points, exclusive.
@@ -122,9 +106,8 @@ private:
   /// @param correction the pitch correction that should be applied to the sample, in cents.
   /// @param link the associated right or left stereo sample. nullptr is allowed.
   /// @param type both the type of sample and the whether the sample is located in RAM or ROM memory.
-  /// @return the output stream.
-  /// @throws std::ios_base::failure An I/O error occurred.
-  static std::ostream & WriteItem(std::ostream & out,
+  /// @return the position following the written item.
+  static char * WriteItem(char * out,
       const std::string & name, uint32_t start, uint32_t end,
       uint32_t start_loop, uint32_t end_loop, uint32_t sample_rate,
       uint8_t original_key, int8_t correction, uint16_t link, SFSampleLink type);
@@ -134,9 +117,6 @@ private:
 
   /// The samples of the chunk.
   const std::vector<std::shared_ptr<SFSample>> * samples_;
-
-  /// The map containing the samples as keys and their indices as map values.
-  std::unordered_map<const SFSample *, uint16_t> sample_index_map_;
 };
 
 } // namespace sf2cute
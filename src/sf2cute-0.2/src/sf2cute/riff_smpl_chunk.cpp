@@ -6,10 +6,14 @@
 #include "riff_smpl_chunk.hpp"
 
 #include <stdint.h>
+#include <stddef.h>
+#include <algorithm>
+#include <iterator>
 #include <memory>
 #include <string>
 #include <ostream>
 #include <stdexcept>
+#include <vector>
 
 #include <sf2cute/sample.hpp>
 
@@ -17,6 +21,20 @@
 
 namespace sf2cute {
 
+namespace {
+
+/// The number of data points staged at a time when they cannot be written in place.
+constexpr size_t kStagingLength = 4096;
+
+/// Returns true if the host stores integers in little-endian order.
+/// @return true if the host stores integers in little-endian order.
+bool IsLittleEndianHost() noexcept {
+  const uint16_t probe = 1;
+  return *reinterpret_cast<const uint8_t *>(&probe) == 1;
+}
+
+} // namespace
+
 /// Constructs a new empty SFRIFFSmplChunk.
 SFRIFFSmplChunk::SFRIFFSmplChunk() :
     size_(0),
@@ -30,41 +48,98 @@ SFRIFFSmplChunk::SFRIFFSmplChunk(
   size_ = GetSamplePoolSize();
 }
 
+/// Writes this chunk to the specified buffer.
+char * SFRIFFSmplChunk::Write(char * out) const {
+  // Write the chunk header.
+  out = RIFFChunk::WriteHeader(out, name(), size_);
+
+  // Write the chunk data.
+  for (const auto & sample : samples()) {
+    // Write the samples.
+    out = WriteSampleData(out, *sample);
+
+    // Write terminator samples.
+    out = std::fill_n(out, SFSample::kTerminatorSampleLength * sizeof(int16_t), 0);
+  }
+
+  // Write a padding byte if necessary.
+  if (size_ % 2 != 0) {
+    out = WriteInt8(out, 0);
+  }
+
+  return out;
+}
+
 /// Writes this chunk to the specified output stream.
 void SFRIFFSmplChunk::Write(std::ostream & out) const {
-  // Save exception bits of output stream.
-  const std::ios_base::iostate old_exception_bits = out.exceptions();
-  // Set exception bits to get output error as an exception.
-  out.exceptions(std::ios::badbit | std::ios::failbit);
-
-  try {
-    // Write the chunk header.
-    RIFFChunk::WriteHeader(out, name(), size_);
-
-    // Write the chunk data.
-    for (const auto & sample : samples()) {
-      // Write the samples.
-      for (int16_t value : sample->data()) {
-        InsertInt16L(out, value);
-      }
-
-      // Write terminator samples.
-      for (uint32_t index = 0; index < SFSample::kTerminatorSampleLength; index++) {
-        InsertInt16L(out, 0);
-      }
-    }
+  // Write the chunk header.
+  char header[8];
+  RIFFChunk::WriteHeader(header, name(), size_);
+  out.write(header, sizeof(header));
 
-    // Write a padding byte if necessary.
-    if (size_ % 2 != 0) {
-      InsertInt8(out, 0);
-    }
+  // Terminator samples are all zero, so each run of them is a single write.
+  static const char terminator[SFSample::kTerminatorSampleLength * sizeof(int16_t)] = {};
+
+  // Write the chunk data, one sample at a time.
+  std::vector<char> buffer;
+  for (const auto & sample : samples()) {
+    // Write the samples.
+    WriteSampleData(out, *sample, buffer);
+
+    // Write terminator samples.
+    out.write(terminator, sizeof(terminator));
   }
-  catch (const std::exception &) {
-    // Recover exception bits of output stream.
-    out.exceptions(old_exception_bits);
 
-    // Rethrow the exception.
-    throw;
+  // Write a padding byte if necessary.
+  if (size_ % 2 != 0) {
+    InsertInt8(out, 0);
+  }
+}
+
+/// Writes the data points of a sample in little-endian order.
+char * SFRIFFSmplChunk::WriteSampleData(char * out, const SFSample & sample) {
+  // A sample backed by a source is only resident while it is written.
+  const SFSampleData data = sample.Load();
+
+  // Contiguous data points already have the layout of the chunk on little-endian hosts.
+  if (data.stride == 1 && IsLittleEndianHost()) {
+    const char * points = reinterpret_cast<const char *>(data.points);
+    return std::copy(points, points + sample.size() * sizeof(int16_t), out);
+  }
+
+  // Otherwise, each data point is stored in order.
+  for (size_t index = 0; index < sample.size(); index++) {
+    out = WriteInt16L(out, static_cast<uint16_t>(data.points[index * data.stride]));
+  }
+  return out;
+}
+
+/// Writes the data points of a sample in little-endian order.
+void SFRIFFSmplChunk::WriteSampleData(std::ostream & out,
+    const SFSample & sample,
+    std::vector<char> & buffer) {
+  // A sample backed by a source is only resident while it is written.
+  const SFSampleData data = sample.Load();
+
+  // Contiguous data points already have the layout of the chunk on little-endian hosts.
+  if (data.stride == 1 && IsLittleEndianHost()) {
+    out.write(reinterpret_cast<const char *>(data.points),
+        static_cast<std::streamsize>(sample.size() * sizeof(int16_t)));
+    return;
+  }
+
+  // Otherwise, the data points are gathered and ordered through the staging buffer.
+  buffer.resize(kStagingLength * sizeof(int16_t));
+  for (size_t offset = 0; offset < sample.size(); offset += kStagingLength) {
+    size_t length = std::min(kStagingLength, sample.size() - offset);
+    const int16_t * points = data.points + offset * data.stride;
+
+    char * staged = buffer.data();
+    for (size_t index = 0; index < length; index++) {
+      staged = WriteInt16L(staged, static_cast<uint16_t>(points[index * data.stride]));
+    }
+
+    out.write(buffer.data(), static_cast<std::streamsize>(length * sizeof(int16_t)));
   }
 }
 
@@ -73,7 +148,7 @@ SFRIFFSmplChunk::size_type SFRIFFSmplChunk::GetSamplePoolSize() const {
   SFRIFFSmplChunk::size_type size = 0;
   for (const auto & sample : samples()) {
     size += sizeof(int16_t) *
-        (sample->data().size() + SFSample::kTerminatorSampleLength);
+        (sample->size() + SFSample::kTerminatorSampleLength);
     if (size > UINT32_MAX) {
       throw std::length_error("The sample pool size exceeds the maximum.");
     }
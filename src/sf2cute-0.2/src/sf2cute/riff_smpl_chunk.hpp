@@ -75,7 +75,17 @@ public:
     return 8 + size_;
   }
 
+  /// Writes this chunk to the specified buffer.
+  /// @param out the output buffer, which must have room for size() bytes.
+  /// @return the position following the written chunk.
+  /// @throws std::length_error The chunk size exceeds the maximum.
+  virtual char * Write(char * out) const override;
+
   /// Writes this chunk to the specified output stream.
+  ///
+  /// Only one sample is resident at a time, so a sample backed by a source
+  /// is produced, written and released before the next one.
+  ///
   /// @param out the output stream.
   /// @throws std::length_error The chunk size exceeds the maximum.
   /// @throws std::ios_base::failure An I/O error occurred.
@@ -87,6 +97,23 @@ private:
   /// @throws std::length_error The sample pool size exceeds the maximum.
   size_type GetSamplePoolSize() const;
 
+  /// Writes the data points of a sample in little-endian order.
+  /// @param out the output buffer.
+  /// @param sample the sample to be written.
+  /// @return the position following the written data points.
+  /// @throws std::length_error The sample's source produced no sample data.
+  static char * WriteSampleData(char * out, const SFSample & sample);
+
+  /// Writes the data points of a sample in little-endian order.
+  /// @param out the output stream.
+  /// @param sample the sample to be written.
+  /// @param buffer the staging buffer for data points that cannot be written in place.
+  /// @throws std::length_error The sample's source produced no sample data.
+  /// @throws std::ios_base::failure An I/O error occurred.
+  static void WriteSampleData(std::ostream & out,
+      const SFSample & sample,
+      std::vector<char> & buffer);
+
   /// The size of the chunk (excluding header).
   size_type size_;
 
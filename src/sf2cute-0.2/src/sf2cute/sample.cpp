@@ -6,8 +6,10 @@
 #include <sf2cute/sample.hpp>
 
 #include <stdint.h>
+#include <stddef.h>
 #include <memory>
 #include <algorithm>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -22,7 +24,11 @@ SFSample::SFSample() :
     correction_(0),
     link_(),
     type_(SFSampleLink::kMonoSample),
-    parent_file_(nullptr) {
+    data_(nullptr),
+    size_(0),
+    stride_(1),
+    parent_file_(nullptr),
+    index_(0) {
 }
 
 /// Constructs a new empty SFSample using the specified name.
@@ -35,7 +41,11 @@ SFSample::SFSample(std::string name) :
     correction_(0),
     link_(),
     type_(SFSampleLink::kMonoSample),
-    parent_file_(nullptr) {
+    data_(nullptr),
+    size_(0),
+    stride_(1),
+    parent_file_(nullptr),
+    index_(0) {
 }
 
 /// Constructs a new SFSample.
@@ -47,7 +57,6 @@ SFSample::SFSample(std::string name,
     uint8_t original_key,
     int8_t correction) :
     name_(std::move(name)),
-    data_(std::move(data)),
     start_loop_(std::move(start_loop)),
     end_loop_(std::move(end_loop)),
     sample_rate_(std::move(sample_rate)),
@@ -55,7 +64,9 @@ SFSample::SFSample(std::string name,
     correction_(std::move(correction)),
     link_(),
     type_(SFSampleLink::kMonoSample),
-    parent_file_(nullptr) {
+    parent_file_(nullptr),
+    index_(0) {
+  set_owned_data(std::move(data));
 }
 
 /// Constructs a new SFSample with a sample link.
@@ -69,7 +80,6 @@ SFSample::SFSample(std::string name,
     std::weak_ptr<SFSample> link,
     SFSampleLink type) :
     name_(std::move(name)),
-    data_(std::move(data)),
     start_loop_(std::move(start_loop)),
     end_loop_(std::move(end_loop)),
     sample_rate_(std::move(sample_rate)),
@@ -77,13 +87,66 @@ SFSample::SFSample(std::string name,
     correction_(std::move(correction)),
     link_(std::move(link)),
     type_(std::move(type)),
-    parent_file_(nullptr) {
+    parent_file_(nullptr),
+    index_(0) {
+  set_owned_data(std::move(data));
+}
+
+/// Constructs a new SFSample that borrows its sample data.
+SFSample::SFSample(std::string name,
+    std::shared_ptr<const void> owner,
+    const int16_t * data,
+    size_t size,
+    size_t stride,
+    uint32_t start_loop,
+    uint32_t end_loop,
+    uint32_t sample_rate,
+    uint8_t original_key,
+    int8_t correction) :
+    name_(std::move(name)),
+    start_loop_(std::move(start_loop)),
+    end_loop_(std::move(end_loop)),
+    sample_rate_(std::move(sample_rate)),
+    original_key_(std::move(original_key)),
+    correction_(std::move(correction)),
+    link_(),
+    type_(SFSampleLink::kMonoSample),
+    owner_(std::move(owner)),
+    data_(data),
+    size_(size),
+    stride_(stride),
+    parent_file_(nullptr),
+    index_(0) {
+}
+
+/// Constructs a new SFSample whose sample data is produced when it is written.
+SFSample::SFSample(std::string name,
+    std::shared_ptr<const SFSampleSource> source,
+    size_t size,
+    uint32_t start_loop,
+    uint32_t end_loop,
+    uint32_t sample_rate,
+    uint8_t original_key,
+    int8_t correction) :
+    name_(std::move(name)),
+    start_loop_(std::move(start_loop)),
+    end_loop_(std::move(end_loop)),
+    sample_rate_(std::move(sample_rate)),
+    original_key_(std::move(original_key)),
+    correction_(std::move(correction)),
+    link_(),
+    type_(SFSampleLink::kMonoSample),
+    source_(std::move(source)),
+    data_(nullptr),
+    size_(size),
+    stride_(1),
+    parent_file_(nullptr),
+    index_(0) {
 }
 
 /// Constructs a new copy of specified SFSample.
 SFSample::SFSample(const SFSample & origin) :
     name_(origin.name_),
-    data_(origin.data_),
     start_loop_(origin.start_loop_),
     end_loop_(origin.end_loop_),
     sample_rate_(origin.sample_rate_),
@@ -91,13 +154,19 @@ SFSample::SFSample(const SFSample & origin) :
     correction_(origin.correction_),
     link_(origin.link_),
     type_(origin.type_),
-    parent_file_(nullptr) {
+    source_(origin.source_),
+    owner_(origin.owner_),
+    owned_data_(origin.owned_data_),
+    data_(origin.data_),
+    size_(origin.size_),
+    stride_(origin.stride_),
+    parent_file_(nullptr),
+    index_(0) {
 }
 
 /// Copy-assigns a new value to the SFSample, replacing its current contents.
 SFSample & SFSample::operator=(const SFSample & origin) {
   name_ = origin.name_;
-  data_ = origin.data_;
   start_loop_ = origin.start_loop_;
   end_loop_ = origin.end_loop_;
   sample_rate_ = origin.sample_rate_;
@@ -105,8 +174,51 @@ SFSample & SFSample::operator=(const SFSample & origin) {
   correction_ = origin.correction_;
   link_ = origin.link_;
   type_ = origin.type_;
+  source_ = origin.source_;
+  owner_ = origin.owner_;
+  owned_data_ = origin.owned_data_;
+  data_ = origin.data_;
+  size_ = origin.size_;
+  stride_ = origin.stride_;
   parent_file_ = nullptr;
+  index_ = 0;
   return *this;
 }
 
+/// Returns the sample data, producing it from the source if necessary.
+SFSampleData SFSample::Load() const {
+  if (source_ == nullptr) {
+    return SFSampleData{owner_, data_, stride_};
+  }
+
+  SFSampleData data = source_->Load();
+  if (data.points == nullptr && size_ != 0) {
+    throw std::length_error("Sample source produced no sample data.");
+  }
+  return data;
+}
+
+/// Returns the sample data.
+const std::vector<int16_t> & SFSample::data() const {
+  if (owned_data_ == nullptr) {
+    const SFSampleData loaded = Load();
+    auto gathered = std::make_shared<std::vector<int16_t>>(size_);
+    for (size_t index = 0; index < size_; index++) {
+      (*gathered)[index] = loaded.points[index * loaded.stride];
+    }
+    owned_data_ = std::move(gathered);
+  }
+  return *owned_data_;
+}
+
+/// Takes ownership of the specified sample data.
+void SFSample::set_owned_data(std::vector<int16_t> data) {
+  auto owned = std::make_shared<const std::vector<int16_t>>(std::move(data));
+  data_ = owned->data();
+  size_ = owned->size();
+  stride_ = 1;
+  owned_data_ = owned;
+  owner_ = std::move(owned);
+}
+
 } // namespace sf2cute
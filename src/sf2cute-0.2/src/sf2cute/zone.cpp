@@ -75,7 +75,12 @@ void SFZone::SetGenerator(SFGeneratorItem generator) {
   // Find the generator.
   const auto it = FindGenerator(generator.op());
   if (it == generators_.end()) {
-    generators_.push_back(std::make_unique<SFGeneratorItem>(std::move(generator)));
+    // Keep the generators sorted, so that they can be written as they are.
+    const auto position = std::upper_bound(generators_.begin(), generators_.end(), generator.op(),
+      [](SFGenerator op, const std::unique_ptr<SFGeneratorItem> & other) {
+        return SFGeneratorItem::Compare(op, other->op());
+      });
+    generators_.insert(position, std::make_unique<SFGeneratorItem>(std::move(generator)));
   }
   else {
     const std::unique_ptr<SFGeneratorItem> & old_generator = *it;
@@ -0,0 +1,140 @@
+#include "../src/Dsp.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+// Whatever lies between or past the samples of a stream has to be left alone
+const int16_t Untouched = 0x5A5A;
+
+// A set of streams decoded side by side, with mixed lengths so that lanes end at different frames
+struct DspBatch
+{
+	vector<vector<uint8_t>> Frames;
+	vector<vector<int16_t>> Coeffs;
+	vector<vector<int16_t>> Samples;
+	vector<DspStream> Streams;
+
+	DspBatch(mt19937& random, size_t count, size_t stride)
+	{
+		uniform_int_distribution<int> byte(0, 255);
+		uniform_int_distribution<int> coeff(-4096, 4096);
+		uniform_int_distribution<int> hist(-32768, 32767);
+		uniform_int_distribution<uint32_t> length(0, 14 * 12);
+
+		// The streams point into the buffers, so these must never move
+		Frames.reserve(count);
+		Coeffs.reserve(count);
+		Samples.reserve(count);
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			// Lengths land on and between frame boundaries, including empty and single frame streams
+			uint32_t sampleCount = length(random);
+
+			if ((i % 3) == 0)
+			{
+				sampleCount -= sampleCount % 14;
+			}
+
+			// Each stream is sized to its last frame, so that a read past it is a read past the buffer
+			Frames.emplace_back(((sampleCount + 13) / 14) * 8);
+
+			// Scales past 12 only come from damaged files, but every kernel has to clamp them the same way
+			for (uint8_t& b : Frames.back())
+			{
+				b = static_cast<uint8_t>(byte(random));
+			}
+
+			Coeffs.emplace_back(16);
+
+			for (int16_t& c : Coeffs.back())
+			{
+				c = static_cast<int16_t>(coeff(random));
+			}
+
+			// One spare sample of output catches a store past the end
+			Samples.emplace_back((sampleCount + 1) * stride, Untouched);
+
+			int16_t hist1 = static_cast<int16_t>(hist(random));
+			int16_t hist2 = static_cast<int16_t>(hist(random));
+
+			Streams.push_back(DspStream{ Frames.back().data(), Coeffs.back().data(), hist1, hist2, Samples.back().data(), stride, sampleCount });
+		}
+	}
+};
+
+bool Compare(const char* name, const DspBatch& expected, const DspBatch& actual)
+{
+	for (size_t i = 0; i < expected.Samples.size(); ++i)
+	{
+		for (size_t j = 0; j < expected.Samples[i].size(); ++j)
+		{
+			if (actual.Samples[i][j] != expected.Samples[i][j])
+			{
+				printf("%s: stream %zu of %zu, sample %zu of %u is %d, expected %d\n", name, i, expected.Samples.size(), j / expected.Streams[i].Stride, expected.Streams[i].SampleCount, actual.Samples[i][j], expected.Samples[i][j]);
+
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+// Decodes the same random streams one at a time with the scalar decoder and side by side with the kernel
+bool Check(const char* name, void (*decode)(DspStream*, size_t), size_t lanes, uint32_t seed)
+{
+	bool result = true;
+
+	for (size_t count = 1; count <= lanes; ++count)
+	{
+		for (size_t stride = 1; stride <= 2; ++stride)
+		{
+			mt19937 expectedRandom(seed);
+			mt19937 actualRandom(seed);
+
+			DspBatch expected(expectedRandom, count, stride);
+			DspBatch actual(actualRandom, count, stride);
+
+			for (DspStream& stream : expected.Streams)
+			{
+				DecodeDspScalar(stream);
+			}
+
+			decode(actual.Streams.data(), count);
+
+			result = Compare(name, expected, actual) && result;
+		}
+	}
+
+	return result;
+}
+
+int main()
+{
+	bool result = true;
+
+	for (uint32_t seed = 0; seed < 200; ++seed)
+	{
+		result = Check("dispatch", DecodeDsp, 19, seed) && result;
+
+#ifdef DSP_X86
+		if (HasSse41())
+		{
+			result = Check("sse4.1", DecodeDspSse41, 4, seed) && result;
+		}
+
+		if (HasAvx2())
+		{
+			result = Check("avx2", DecodeDspAvx2, 8, seed) && result;
+		}
+#endif
+	}
+
+	return result ? 0 : 1;
+}
@@ -0,0 +1,69 @@
+#include "../src/Ima.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+using namespace std;
+
+// Known answers for the 3DS IMA expansion, low nibble first. These were not produced by vgmstream itself: they are
+// hand-derived from our own line-by-line transcription of its n3ds_ima_expand_nibble, kept apart from Ima.cpp
+struct ImaVector
+{
+	const char* Name;
+	vector<uint8_t> Data;
+	int16_t Hist;
+	uint8_t Index;
+	vector<int16_t> Expected;
+};
+
+bool Check(const ImaVector& vec)
+{
+	vector<uint8_t> data = vec.Data;
+	vector<int16_t> samples(vec.Expected.size());
+
+	ImaStream stream{ data.data(), vec.Hist, vec.Index, samples.data(), 1 };
+
+	DecodeIma(stream, static_cast<uint32_t>(samples.size()));
+
+	for (size_t i = 0; i < samples.size(); ++i)
+	{
+		if (samples[i] != vec.Expected[i])
+		{
+			printf("%s: sample %zu is %d, expected %d\n", vec.Name, i, samples[i], vec.Expected[i]);
+
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int main()
+{
+	// Small steps first, where the 3DS expansion differs from the standard one, then a climb that clips at both ends
+	ImaVector ramp
+	{
+		"ramp",
+		{ 0x01, 0x10, 0x89, 0x98, 0x23, 0x32, 0xAB, 0xBA, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x07, 0xF0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x88, 0x88, 0x4C, 0xC4, 0x5D, 0xD5 },
+		0,
+		0,
+		{ 2, 2, 2, 4, 1, 0, -1, -4, 2, 6, 10, 16, 9, 4, -1, -8, 5, 35, 98, 234, 528, 1159, 2516, 5426, 11664, 25036, 32767, 32767, 32767, 32767, 32767, 32767, 32767, 32767, 32767, 32767, 32767, 32767, 32767, -18020, -32768, -32768, -32768, -32768, -32768, -32768, -32768, -32768, -32768, -32768, -32768, -32768, -28673, -24949, -21564, -18487, -15689, -13146, -10834, -8732, -6821, -5084, -3505, -2070, -765, 421, 1499, 2479, 1587, 776, 39, -631, -6111, 519, 8542, -1167, -15525, 5497, 32767, -12288 }
+	};
+
+	// A context taken from the middle of a stream, ending on a low nibble
+	ImaVector resume
+	{
+		"resume",
+		{ 0x3C, 0xA5, 0x0F, 0x96, 0x71 },
+		-1234,
+		40,
+		{ -1614, -1257, -747, -1087, -2014, -1882, -318, -959, -377 }
+	};
+
+	bool result = Check(ramp);
+	result = Check(resume) && result;
+
+	return result ? 0 : 1;
+}